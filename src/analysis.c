@@ -0,0 +1,301 @@
+#include "analysis.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+size_t rsa_decode(const trace_record_t *trace, size_t n, int threshold,
+                  char *bits, size_t max_bits) {
+  size_t i = 0;
+  size_t bit_count = 0;
+
+  while (i + 4 < n && bit_count < max_bits) {
+    // A corrupt slot inside the S-R-M-R window makes the bit unreadable;
+    // resynchronise on the next square after it
+    int corrupt = 0;
+    for (int k = 0; k < 3; k++)
+      corrupt |= trace[i + k].flags & TRACE_SLOT_CORRUPT;
+    if (corrupt) {
+      i++;
+      continue;
+    }
+
+    int sqr_hit = trace[i].latency[RSA_LINE_SQR] < threshold;
+    int mul_hit = trace[i + 2].latency[RSA_LINE_MUL] < threshold;
+
+    if (sqr_hit) {
+      // Check if followed by multiply (indicates bit=1)
+      if (mul_hit) {
+        bits[bit_count++] = '1';
+        i += 4; // Skip S-R-M-R sequence
+      } else {
+        bits[bit_count++] = '0';
+        i += 2; // Skip S-R sequence
+      }
+    } else {
+      i++;
+    }
+  }
+  return bit_count;
+}
+
+void analyze_results(const trace_record_t *trace, int total_slots,
+                     int threshold) {
+  printf("\n=== ANALYSIS RESULTS ===\n");
+  printf("Total time slots captured: %d\n", total_slots);
+
+  printf("\nDetected bit sequence:\n");
+
+  // One decoded bit needs at least two slots
+  size_t max_bits = total_slots / 2 + 1;
+  char *bits = malloc(max_bits);
+  if (!bits)
+    return;
+
+  size_t bit_count = rsa_decode(trace, total_slots, threshold, bits, max_bits);
+  for (size_t i = 0; i < bit_count; i += 50) {
+    int len = bit_count - i < 50 ? bit_count - i : 50;
+    printf("%.*s\n", len, bits + i);
+  }
+  free(bits);
+}
+
+static char *read_bits(const char *line, const char *label) {
+  size_t label_len = strlen(label);
+  if (strncmp(line, label, label_len) != 0 || line[label_len] != ' ')
+    return NULL;
+
+  const char *start = line + label_len + 1;
+  size_t len = strspn(start, "01");
+  char *bits = malloc(len + 1);
+  if (bits) {
+    memcpy(bits, start, len);
+    bits[len] = '\0';
+  }
+  return bits;
+}
+
+int rsa_truth_load(const char *path, rsa_truth_t *truth) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  memset(truth, 0, sizeof(*truth));
+  char line[RSA_MAX_BITS + 64];
+  while (fgets(line, sizeof(line), f)) {
+    if (!truth->dp)
+      truth->dp = read_bits(line, "dp");
+    if (!truth->dq)
+      truth->dq = read_bits(line, "dq");
+  }
+  fclose(f);
+
+  if (!truth->dp || !truth->dq) {
+    fprintf(stderr, "%s: missing dp/dq lines\n", path);
+    rsa_truth_free(truth);
+    return -1;
+  }
+
+  size_t dp_len = strlen(truth->dp), dq_len = strlen(truth->dq);
+  truth->len = dp_len + dq_len;
+  truth->bits = malloc(truth->len + 1);
+  if (!truth->bits) {
+    rsa_truth_free(truth);
+    return -1;
+  }
+  memcpy(truth->bits, truth->dp, dp_len);
+  memcpy(truth->bits + dp_len, truth->dq, dq_len + 1);
+  return 0;
+}
+
+void rsa_truth_free(rsa_truth_t *truth) {
+  free(truth->dp);
+  free(truth->dq);
+  free(truth->bits);
+  memset(truth, 0, sizeof(*truth));
+}
+
+size_t edit_distance(const char *a, size_t la, const char *b, size_t lb) {
+  size_t *prev = malloc((lb + 1) * sizeof(size_t));
+  size_t *cur = malloc((lb + 1) * sizeof(size_t));
+  if (!prev || !cur) {
+    free(prev);
+    free(cur);
+    return la > lb ? la : lb;
+  }
+
+  for (size_t j = 0; j <= lb; j++)
+    prev[j] = j;
+
+  for (size_t i = 1; i <= la; i++) {
+    cur[0] = i;
+    for (size_t j = 1; j <= lb; j++) {
+      size_t best = prev[j - 1] + (a[i - 1] != b[j - 1]);
+      if (prev[j] + 1 < best)
+        best = prev[j] + 1;
+      if (cur[j - 1] + 1 < best)
+        best = cur[j - 1] + 1;
+      cur[j] = best;
+    }
+    size_t *tmp = prev;
+    prev = cur;
+    cur = tmp;
+  }
+
+  size_t dist = prev[lb];
+  free(prev);
+  free(cur);
+  return dist;
+}
+
+void rsa_score_segment(const trace_record_t *trace, size_t n, int threshold,
+                       const rsa_truth_t *truth, rsa_score_t *score) {
+  char bits[RSA_MAX_BITS];
+
+  score->segments++;
+  size_t len = rsa_decode(trace, n, threshold, bits, sizeof(bits));
+  if (len == 0)
+    return;
+
+  double ber = (double)edit_distance(bits, len, truth->bits, truth->len) /
+               truth->len;
+  if (ber > 1.0)
+    ber = 1.0;
+
+  if (score->scored == 0 || ber < score->ber_best)
+    score->ber_best = ber;
+  score->scored++;
+  score->bits += len;
+  score->ber_sum += ber;
+}
+
+int rsa_segment_next(rsa_segmenter_t *seg, const trace_record_t *trace,
+                     size_t n, size_t *start, size_t *len) {
+  for (size_t i = seg->next; i < n; i++) {
+    int odd = trace[i].op_seq & 1;
+    int ended = seg->in_op &&
+                (!odd || trace[i].op_seq != trace[seg->start].op_seq);
+    if (ended) {
+      *start = seg->start;
+      *len = i - seg->start;
+      seg->in_op = 0;
+    }
+    if (odd && !seg->in_op && i > 0 && trace[i - 1].op_seq != trace[i].op_seq) {
+      seg->start = i;
+      seg->in_op = 1;
+    }
+    if (ended) {
+      seg->next = i + 1;
+      return 1;
+    }
+  }
+  if (n > seg->next)
+    seg->next = n;
+  return 0;
+}
+
+void rsa_score_trace(const trace_record_t *trace, size_t n, int threshold,
+                     const rsa_truth_t *truth, rsa_score_t *score) {
+  rsa_segmenter_t seg = {0};
+  size_t start, len;
+
+  memset(score, 0, sizeof(*score));
+  score->ber_best = 1.0;
+
+  while (rsa_segment_next(&seg, trace, n, &start, &len))
+    rsa_score_segment(trace + start, len, threshold, truth, score);
+}
+
+void rsa_stream_init(rsa_stream_t *st, size_t max_slots) {
+  memset(st, 0, sizeof(*st));
+  st->max_slots = max_slots;
+}
+
+int rsa_stream_feed(rsa_stream_t *st, const trace_record_t *recs, size_t n,
+                    rsa_segment_fn fn, void *arg) {
+  size_t start, len;
+
+  if (n == 0)
+    return 0;
+  if (st->count + n > st->cap) {
+    size_t cap = st->count + n > 2 * st->cap ? st->count + n : 2 * st->cap;
+    trace_record_t *buf = realloc(st->buf, cap * sizeof(*buf));
+    if (!buf)
+      return -1;
+    st->buf = buf;
+    st->cap = cap;
+  }
+  memcpy(st->buf + st->count, recs, n * sizeof(*recs));
+  st->count += n;
+
+  while (rsa_segment_next(&st->seg, st->buf, st->count, &start, &len))
+    fn(st->buf + start, len, st->base + start, arg);
+
+  // Keep the open segment, or the last slot, which the segmenter compares
+  // the next one against
+  size_t keep = st->seg.in_op ? st->seg.start : st->count - 1;
+  if (st->seg.in_op && st->count - keep > st->max_slots) {
+    st->seg.in_op = 0;
+    st->dropped++;
+    keep = st->count - 1;
+  }
+  memmove(st->buf, st->buf + keep, (st->count - keep) * sizeof(*st->buf));
+  st->count -= keep;
+  st->base += keep;
+  st->seg.next -= keep;
+  st->seg.start -= st->seg.in_op ? keep : 0;
+  return 0;
+}
+
+void rsa_stream_free(rsa_stream_t *st) {
+  free(st->buf);
+  memset(st, 0, sizeof(*st));
+}
+
+void rsa_online_init(rsa_online_t *on) { memset(on, 0, sizeof(*on)); }
+
+static void online_vote(rsa_online_t *on, const char *bits, size_t len) {
+  for (size_t p = 0; p < len; p++) {
+    char before = on->votes[p] && 2 * on->ones[p] > on->votes[p] ? '1' : '0';
+    on->votes[p]++;
+    on->ones[p] += bits[p] == '1';
+    char after = 2 * on->ones[p] > on->votes[p] ? '1' : '0';
+    on->held[p] = on->votes[p] > 1 && after == before ? on->held[p] + 1 : 0;
+  }
+}
+
+void rsa_online_feed(rsa_online_t *on, const trace_record_t *trace, size_t n,
+                     int threshold) {
+  char bits[RSA_MAX_BITS];
+  size_t start, len;
+
+  while (rsa_segment_next(&on->seg, trace, n, &start, &len)) {
+    on->segments++;
+    size_t decoded =
+        rsa_decode(trace + start, len, threshold, bits, sizeof(bits));
+    if (decoded == 0)
+      continue;
+    on->scored++;
+    online_vote(on, bits, decoded);
+  }
+}
+
+void rsa_online_convergence(rsa_online_t *on, rsa_convergence_t *conv) {
+  uint64_t votes = 0, against = 0;
+
+  memset(conv, 0, sizeof(*conv));
+  for (size_t p = 0; p < RSA_MAX_BITS && on->scored > 0 &&
+                     2 * on->votes[p] >= on->scored;
+       p++) {
+    int one = 2 * on->ones[p] > on->votes[p];
+    on->estimate[p] = one ? '1' : '0';
+    votes += on->votes[p];
+    against += one ? on->votes[p] - on->ones[p] : on->ones[p];
+    conv->stable += on->held[p] >= RSA_ONLINE_STABLE;
+    conv->len = p + 1;
+  }
+  on->estimate[conv->len] = '\0';
+  conv->est_error = votes ? (double)against / votes : 1.0;
+}
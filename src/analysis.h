@@ -0,0 +1,130 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+// Offline analysis of RSA captures: square-and-multiply decoding, victim
+// ground truth and scoring. Shared by attacker_rsa and bench_driver.
+
+#define RSA_LINE_SQR 0
+#define RSA_LINE_MUL 1
+#define RSA_LINE_RED 2
+
+#define RSA_MAX_BITS 4096 // decoded bits kept per segment
+
+// Ground truth written by victim_rsa --key-out
+typedef struct {
+  char *dp;
+  char *dq;
+  char *bits; // dp followed by dq, the order of the two exponentiations
+  size_t len;
+} rsa_truth_t;
+
+typedef struct {
+  uint64_t segments;  // victim operations seen in the trace
+  uint64_t scored;    // segments that decoded to at least one bit
+  uint64_t bits;      // decoded bits over all scored segments
+  double ber_sum;     // sum of per-segment bit error rates
+  double ber_best;    // lowest per-segment bit error rate
+} rsa_score_t;
+
+// Decode one stretch of slots: S-R-M-R = 1 bit, S-R = 0 bit. Slots flagged
+// TRACE_SLOT_CORRUPT are never read.
+// Returns the number of bits written to bits (not NUL terminated).
+size_t rsa_decode(const trace_record_t *trace, size_t n, int threshold,
+                  char *bits, size_t max_bits);
+
+// Print the bit sequence decoded from a whole capture
+void analyze_results(const trace_record_t *trace, int total_slots,
+                     int threshold);
+
+int rsa_truth_load(const char *path, rsa_truth_t *truth);
+void rsa_truth_free(rsa_truth_t *truth);
+
+// Levenshtein distance; decoding errors are mostly dropped or extra bits
+size_t edit_distance(const char *a, size_t la, const char *b, size_t lb);
+
+// Split a trace into victim operations using the recorded op_seq tags,
+// decode each and accumulate its bit error rate against the truth.
+void rsa_score_trace(const trace_record_t *trace, size_t n, int threshold,
+                     const rsa_truth_t *truth, rsa_score_t *score);
+
+// Victim operations in a stream of slots. A segment is a maximal run of slots
+// tagged with the same odd op_seq; operations already running when the
+// capture started are skipped. Slots can arrive in pieces, as long as the
+// trace array holding them stays in place.
+typedef struct {
+  size_t next;  // first slot not looked at yet
+  size_t start; // first slot of the open segment
+  int in_op;
+} rsa_segmenter_t;
+
+// Look at slots up to n. Returns 1 with the next segment that ended before
+// n in [*start, *start + *len), or 0 once every slot before n was seen.
+int rsa_segment_next(rsa_segmenter_t *seg, const trace_record_t *trace,
+                     size_t n, size_t *start, size_t *len);
+
+// Segment-at-a-time analysis of a trace arriving in chunks (trace_map_next).
+// Slots of the open segment are carried over to the next chunk, so memory is
+// bounded by the longest segment rather than the trace. A segment longer
+// than max_slots is dropped, slots and all.
+typedef void (*rsa_segment_fn)(const trace_record_t *slots, size_t n,
+                               uint64_t first_slot, void *arg);
+
+typedef struct {
+  rsa_segmenter_t seg;
+  trace_record_t *buf; // carried slots followed by the current chunk
+  size_t count;
+  size_t cap;
+  uint64_t base; // trace slot of buf[0]
+  size_t max_slots;
+  uint64_t dropped; // segments over max_slots
+} rsa_stream_t;
+
+#define RSA_STREAM_MAX_SLOTS (1 << 20)
+
+void rsa_stream_init(rsa_stream_t *st, size_t max_slots);
+// Call fn on every segment that ends within the chunk. Returns -1 when out
+// of memory.
+int rsa_stream_feed(rsa_stream_t *st, const trace_record_t *recs, size_t n,
+                    rsa_segment_fn fn, void *arg);
+void rsa_stream_free(rsa_stream_t *st);
+
+// Add one segment to score, as rsa_score_trace does for each. Start from a
+// zeroed score with ber_best 1.0.
+void rsa_score_segment(const trace_record_t *trace, size_t n, int threshold,
+                       const rsa_truth_t *truth, rsa_score_t *score);
+
+// Incremental decoding while a capture runs. Each completed segment is
+// decoded and votes on the bit at every position; the majority is the
+// estimate. An estimate is stable once it has held for RSA_ONLINE_STABLE
+// further votes.
+#define RSA_ONLINE_STABLE 8
+
+typedef struct {
+  rsa_segmenter_t seg;
+  uint64_t segments;      // victim operations seen
+  uint64_t scored;        // segments that decoded to at least one bit
+  uint32_t votes[RSA_MAX_BITS];
+  uint32_t ones[RSA_MAX_BITS];
+  uint32_t held[RSA_MAX_BITS]; // votes since the estimate last changed
+  char estimate[RSA_MAX_BITS + 1];
+} rsa_online_t;
+
+typedef struct {
+  size_t len;       // positions reached by half of the scored segments
+  size_t stable;    // of those, positions whose estimate is stable
+  double est_error; // votes against the estimate, a per-segment bit error
+} rsa_convergence_t;
+
+void rsa_online_init(rsa_online_t *on);
+// Decode the segments completed within the first n slots of trace
+void rsa_online_feed(rsa_online_t *on, const trace_record_t *trace, size_t n,
+                     int threshold);
+// Current estimate in on->estimate (NUL terminated at conv->len)
+void rsa_online_convergence(rsa_online_t *on, rsa_convergence_t *conv);
+
+#endif
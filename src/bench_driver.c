@@ -0,0 +1,671 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analysis.h"
+#include "harness.h"
+#include "trace.h"
+
+// End-to-end benchmark driver.
+//
+// Launches victim_rsa pinned to one core, waits until it publishes a ready
+// status page, runs attacker_rsa pinned to another core to capture a trace,
+// then scores the trace against the victim's ground truth key file and
+// emits a JSON summary for cross-machine comparison.
+//
+// With --victims N it starts N victims instead, each with its own copy of
+// the library, key file and status page, and one attacker per LLC domain
+// that captures every victim placed in that domain.
+
+#define STATUS_NAME "bench"
+#define DEFAULT_SLOTS 200000
+#define DEFAULT_OUT_DIR "bench_out"
+#define READY_TIMEOUT_MS 60000
+#define MAX_VICTIMS 16 // attacker_rsa's limit per capture thread
+#define MAX_CPUS 1024
+#define LIBRARY_PATH "./lib/libgcrypt.so.11.6.0"
+#define LIBRARY_SONAME "libgcrypt.so.11"
+
+typedef struct {
+  int victim_core;
+  int attacker_core;
+  int slots;
+  const char *engine; // attacker_rsa --engine
+  const char *level;  // attacker_rsa --level, for Prime+Probe
+  int victims;        // multi-victim mode when > 0
+  const char *converge; // attacker_rsa --converge, or NULL for all slots
+  const char *out_dir;
+  const char *json_path;
+} bench_config_t;
+
+static double monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fork and exec argv pinned to core, with stdout and stderr sent to log.
+// A non-NULL lib_dir is searched for shared libraries first.
+pid_t spawn_pinned(int core, const char *log, const char *lib_dir,
+                   char *const argv[]) {
+  pid_t pid = fork();
+  if (pid != 0)
+    return pid;
+
+  if (lib_dir)
+    setenv("LD_LIBRARY_PATH", lib_dir, 1);
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) < 0)
+    fprintf(stderr, "Warning: cannot pin %s to core %d: %s\n", argv[0], core,
+            strerror(errno));
+
+  int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+  }
+
+  execv(argv[0], argv);
+  perror(argv[0]);
+  _exit(127);
+}
+
+void read_cpu_model(char *model, size_t len) {
+  FILE *f = fopen("/proc/cpuinfo", "r");
+  char line[256];
+
+  snprintf(model, len, "unknown");
+  if (!f)
+    return;
+  while (fgets(line, sizeof(line), f)) {
+    char *colon = strchr(line, ':');
+    if (strncmp(line, "model name", 10) == 0 && colon) {
+      snprintf(model, len, "%s", colon + 2);
+      model[strcspn(model, "\n")] = '\0';
+      break;
+    }
+  }
+  fclose(f);
+}
+
+// Print a JSON string value; the fields we emit never need more than quote
+// and backslash escaping
+void json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+static double trace_slots_per_sec(const trace_header_t *hdr,
+                                  const trace_record_t *trace, size_t n) {
+  double span = n > 1 ? (double)(trace[n - 1].tsc - trace[0].tsc) : 0;
+  return span > 0 ? (n - 1) * (double)hdr->tsc_hz / span : 0;
+}
+
+void write_summary(FILE *out, const bench_config_t *cfg,
+                   const trace_header_t *hdr, const trace_record_t *trace,
+                   size_t n, const rsa_truth_t *truth,
+                   const rsa_score_t *score, double wall_time) {
+  char host[256], model[256];
+
+  gethostname(host, sizeof(host));
+  host[sizeof(host) - 1] = '\0';
+  read_cpu_model(model, sizeof(model));
+
+  double slots_per_sec = trace_slots_per_sec(hdr, trace, n);
+
+  fprintf(out, "{\n  \"host\": ");
+  json_string(out, host);
+  fprintf(out, ",\n  \"cpu_model\": ");
+  json_string(out, model);
+  fprintf(out, ",\n  \"victim_core\": %d,\n", cfg->victim_core);
+  fprintf(out, "  \"attacker_core\": %d,\n", cfg->attacker_core);
+  fprintf(out, "  \"engine\": ");
+  json_string(out, trace_engine_name(hdr->engine));
+  if (cfg->converge)
+    fprintf(out, ",\n  \"converge\": %g", atof(cfg->converge));
+  else
+    fprintf(out, ",\n  \"converge\": null");
+  fprintf(out, ",\n  \"load_profile\": ");
+  json_string(out, hdr->load_profile);
+  fprintf(out, ",\n  \"tsc_hz\": %lu,\n", hdr->tsc_hz);
+  fprintf(out, "  \"slot_cycles\": %lu,\n", hdr->slot_cycles);
+  fprintf(out, "  \"threshold\": %u,\n", hdr->threshold);
+  fprintf(out, "  \"slots\": %zu,\n", n);
+  fprintf(out, "  \"slots_per_sec\": %.0f,\n", slots_per_sec);
+
+  fprintf(out, "  \"hit_rate\": {");
+  for (uint32_t l = 0; l < hdr->num_lines; l++) {
+    size_t hits = 0;
+    for (size_t i = 0; i < n; i++)
+      hits += trace[i].latency[l] < hdr->threshold;
+    fprintf(out, "%s\"%s\": %.6f", l ? ", " : "", hdr->line_names[l],
+            n ? (double)hits / n : 0.0);
+  }
+  fprintf(out, "},\n");
+
+  size_t overruns = 0, missed = 0;
+  for (size_t i = 0; i < n; i++) {
+    overruns += (trace[i].flags & TRACE_SLOT_OVERRUN) != 0;
+    missed += (trace[i].flags & TRACE_SLOT_MISSED) != 0;
+  }
+  fprintf(out, "  \"overrun_slots\": %zu,\n", overruns);
+  fprintf(out, "  \"missed_slots\": %zu,\n", missed);
+  fprintf(out, "  \"truth_bits\": %zu,\n", truth->len);
+  fprintf(out, "  \"operations\": %lu,\n", score->segments);
+  fprintf(out, "  \"scored_operations\": %lu,\n", score->scored);
+  fprintf(out, "  \"decoded_bits\": %lu,\n", score->bits);
+  fprintf(out, "  \"bit_error_rate\": %.6f,\n",
+          score->scored ? score->ber_sum / score->scored : 1.0);
+  fprintf(out, "  \"best_bit_error_rate\": %.6f,\n", score->ber_best);
+  fprintf(out, "  \"wall_time_sec\": %.3f\n}\n", wall_time);
+}
+
+// Load a trace and score it against a key file. On success the caller frees
+// *trace, closes tf and frees truth.
+int load_scored_trace(const char *trace_path, const char *key_path,
+                      trace_file_t *tf, trace_record_t **trace,
+                      rsa_truth_t *truth, rsa_score_t *score) {
+  if (rsa_truth_load(key_path, truth) < 0)
+    return -1;
+  if (trace_open(tf, trace_path) < 0) {
+    rsa_truth_free(truth);
+    return -1;
+  }
+
+  size_t n = tf->header.num_slots;
+  *trace = malloc((n ? n : 1) * sizeof(**trace));
+  if (!*trace || trace_read(tf, *trace, n) != n) {
+    fprintf(stderr, "%s: truncated trace\n", trace_path);
+    free(*trace);
+    trace_close(tf);
+    rsa_truth_free(truth);
+    return -1;
+  }
+
+  rsa_score_trace(*trace, n, tf->header.threshold, truth, score);
+  return 0;
+}
+
+// Score a captured trace and write the JSON summary
+int score_run(const bench_config_t *cfg, const char *trace_path,
+              const char *key_path, double wall_time) {
+  rsa_truth_t truth;
+  trace_file_t tf;
+  rsa_score_t score;
+  trace_record_t *trace;
+
+  if (load_scored_trace(trace_path, key_path, &tf, &trace, &truth, &score) < 0)
+    return -1;
+  size_t n = tf.header.num_slots;
+
+  write_summary(stdout, cfg, &tf.header, trace, n, &truth, &score, wall_time);
+  FILE *json = fopen(cfg->json_path, "w");
+  if (json) {
+    write_summary(json, cfg, &tf.header, trace, n, &truth, &score, wall_time);
+    fclose(json);
+    fprintf(stderr, "Summary written to %s\n", cfg->json_path);
+  } else {
+    perror(cfg->json_path);
+  }
+
+  free(trace);
+  trace_close(&tf);
+  rsa_truth_free(&truth);
+  return 0;
+}
+
+// LLC domain of every online CPU, identified by the lowest CPU sharing that
+// CPU's last level cache. Returns the number of CPUs.
+int llc_domains(int *domain, int max_cpus) {
+  int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpus > max_cpus)
+    ncpus = max_cpus;
+
+  for (int cpu = 0; cpu < ncpus; cpu++) {
+    char path[128], list[256] = "";
+    domain[cpu] = cpu;
+    // The highest cache index is the last level
+    for (int index = 0;; index++) {
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+               cpu, index);
+      FILE *f = fopen(path, "r");
+      if (!f)
+        break;
+      if (!fgets(list, sizeof(list), f))
+        list[0] = '\0';
+      fclose(f);
+    }
+    if (list[0])
+      domain[cpu] = atoi(list);
+  }
+  return ncpus;
+}
+
+int copy_file(const char *src, const char *dst) {
+  char buf[65536];
+  ssize_t len;
+  int in = open(src, O_RDONLY);
+  int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  int ret = in >= 0 && out >= 0 ? 0 : -1;
+
+  while (ret == 0 && (len = read(in, buf, sizeof(buf))) > 0) {
+    if (write(out, buf, len) != len)
+      ret = -1;
+  }
+  if (in >= 0)
+    close(in);
+  if (out >= 0 && close(out) < 0)
+    ret = -1;
+  if (ret < 0)
+    fprintf(stderr, "Cannot copy %s to %s: %s\n", src, dst, strerror(errno));
+  return ret;
+}
+
+typedef struct {
+  char dir[512];
+  char status[32];
+  char key_path[512];
+  char trace_path[512];
+  int core;
+  int domain; // index into the attackers
+  pid_t pid;
+  rsa_score_t score;
+  uint32_t engine;      // TRACE_ENGINE_* from the trace header
+  size_t missed;        // slots the capture thread fell behind on
+  double slots_per_sec; // sampled slots, missed ones excluded
+} bench_victim_t;
+
+typedef struct {
+  int core;
+  int num_victims;
+  pid_t pid;
+} bench_attacker_t;
+
+static void stop_victims(bench_victim_t *victims, int n) {
+  for (int i = 0; i < n; i++) {
+    if (victims[i].pid > 0) {
+      kill(victims[i].pid, SIGTERM);
+      waitpid(victims[i].pid, NULL, 0);
+    }
+  }
+}
+
+void write_victims_summary(FILE *out, const bench_config_t *cfg,
+                           const bench_victim_t *victims,
+                           const bench_attacker_t *attackers,
+                           int num_attackers, double wall_time) {
+  char host[256], model[256];
+  double total = 0, ber = 0;
+  int scored = 0;
+
+  gethostname(host, sizeof(host));
+  host[sizeof(host) - 1] = '\0';
+  read_cpu_model(model, sizeof(model));
+
+  fprintf(out, "{\n  \"host\": ");
+  json_string(out, host);
+  fprintf(out, ",\n  \"cpu_model\": ");
+  json_string(out, model);
+  // Named from the traces, as write_summary does, not the --engine spelling
+  fprintf(out, ",\n  \"engine\": ");
+  json_string(out, trace_engine_name(victims[0].engine));
+  fprintf(out, ",\n  \"victims\": %d,\n", cfg->victims);
+  fprintf(out, "  \"capture_threads\": %d,\n", num_attackers);
+  fprintf(out, "  \"slots\": %d,\n", cfg->slots);
+  fprintf(out, "  \"per_victim\": [\n");
+  for (int i = 0; i < cfg->victims; i++) {
+    const bench_victim_t *v = &victims[i];
+    double v_ber = v->score.scored ? v->score.ber_sum / v->score.scored : 1.0;
+    fprintf(out,
+            "    {\"status\": \"%s\", \"core\": %d, \"attacker_core\": %d, "
+            "\"slots_per_sec\": %.0f, \"missed_slots\": %zu, "
+            "\"scored_operations\": %lu, "
+            "\"bit_error_rate\": %.6f, \"best_bit_error_rate\": %.6f}%s\n",
+            v->status, v->core, attackers[v->domain].core, v->slots_per_sec,
+            v->missed, v->score.scored, v_ber, v->score.ber_best,
+            i + 1 < cfg->victims ? "," : "");
+    total += v->slots_per_sec;
+    ber += v_ber;
+    scored++;
+  }
+  fprintf(out, "  ],\n");
+  fprintf(out, "  \"total_slots_per_sec\": %.0f,\n", total);
+  fprintf(out, "  \"mean_bit_error_rate\": %.6f,\n",
+          scored ? ber / scored : 1.0);
+  fprintf(out, "  \"wall_time_sec\": %.3f\n}\n", wall_time);
+}
+
+// Multi-victim run: victims spread round-robin over the LLC domains, each
+// domain's first CPU reserved for its capture thread. A domain with no
+// other CPU left puts its victims on the attacker's CPU.
+int run_victims(const bench_config_t *cfg) {
+  static int domain[MAX_CPUS];
+  bench_victim_t victims[MAX_VICTIMS];
+  bench_attacker_t attackers[MAX_CPUS];
+  int num_attackers = 0;
+  int ncpus = llc_domains(domain, MAX_CPUS);
+  int next_cpu[MAX_CPUS];
+  char slots_arg[32], path[512];
+  int ret = 0;
+
+  // One capture thread per domain, on the domain's first CPU
+  for (int cpu = 0; cpu < ncpus; cpu++) {
+    if (domain[cpu] == cpu) {
+      next_cpu[num_attackers] = cpu;
+      attackers[num_attackers++] = (bench_attacker_t){cpu, 0, -1};
+    }
+  }
+
+  memset(victims, 0, sizeof(victims));
+  double wall_start = monotonic_seconds();
+  for (int i = 0; i < cfg->victims; i++) {
+    bench_victim_t *v = &victims[i];
+    int d = i % num_attackers;
+
+    // Next CPU of domain d that is not its attacker's, wrapping around
+    int cpu = next_cpu[d];
+    for (int k = 0; k < ncpus; k++) {
+      cpu = (cpu + 1) % ncpus;
+      if (domain[cpu] == domain[attackers[d].core] && cpu != attackers[d].core)
+        break;
+    }
+    if (domain[cpu] != domain[attackers[d].core])
+      cpu = attackers[d].core;
+    next_cpu[d] = cpu;
+
+    v->core = cpu;
+    v->domain = d;
+    attackers[d].num_victims++;
+    snprintf(v->dir, sizeof(v->dir), "%s/v%d", cfg->out_dir, i);
+    snprintf(v->status, sizeof(v->status), "%s%d", STATUS_NAME, i);
+    snprintf(v->key_path, sizeof(v->key_path), "%s/v%d/key.txt", cfg->out_dir,
+             i);
+    snprintf(v->trace_path, sizeof(v->trace_path), "%s/v%d/trace.frt",
+             cfg->out_dir, i);
+    snprintf(path, sizeof(path), "%s/v%d/%s", cfg->out_dir, i,
+             LIBRARY_SONAME);
+    if ((mkdir(v->dir, 0755) < 0 && errno != EEXIST) ||
+        copy_file(LIBRARY_PATH, path) < 0) {
+      stop_victims(victims, i);
+      return 1;
+    }
+
+    char *victim_argv[] = {"./victim_rsa", "--status", v->status,
+                           "--key-out",    v->key_path, NULL};
+    snprintf(path, sizeof(path), "%s/v%d/victim.log", cfg->out_dir, i);
+    fprintf(stderr, "Starting victim %d on core %d...\n", i, v->core);
+    v->pid = spawn_pinned(v->core, path, v->dir, victim_argv);
+  }
+
+  for (int i = 0; i < cfg->victims; i++) {
+    harness_status_t *status =
+        harness_status_wait(victims[i].status, READY_TIMEOUT_MS);
+    if (!status || waitpid(victims[i].pid, NULL, WNOHANG) != 0) {
+      fprintf(stderr, "Victim %d did not become ready, see %s/victim.log\n",
+              i, victims[i].dir);
+      harness_status_close(status);
+      stop_victims(victims, cfg->victims);
+      return 1;
+    }
+    harness_status_close(status);
+  }
+
+  // attacker_rsa --victim STATUS:LIBRARY:TRACE for each victim of a domain
+  snprintf(slots_arg, sizeof(slots_arg), "%d", cfg->slots);
+  char specs[MAX_VICTIMS][1024];
+  for (int d = 0; d < num_attackers; d++) {
+    if (attackers[d].num_victims == 0)
+      continue;
+    char *argv[16 + 2 * MAX_VICTIMS];
+    int argc = 0;
+    argv[argc++] = "./attacker_rsa";
+    argv[argc++] = "--slots";
+    argv[argc++] = slots_arg;
+    argv[argc++] = "--engine";
+    argv[argc++] = (char *)cfg->engine;
+    argv[argc++] = "--level";
+    argv[argc++] = (char *)cfg->level;
+    argv[argc++] = "--quiet";
+    for (int i = 0; i < cfg->victims; i++) {
+      if (victims[i].domain != d)
+        continue;
+      snprintf(specs[i], sizeof(specs[i]), "%s:%s/v%d/%s:%s/v%d/trace.frt",
+               victims[i].status, cfg->out_dir, i, LIBRARY_SONAME,
+               cfg->out_dir, i);
+      argv[argc++] = "--victim";
+      argv[argc++] = specs[i];
+    }
+    argv[argc] = NULL;
+
+    snprintf(path, sizeof(path), "%s/attacker%d.log", cfg->out_dir, d);
+    fprintf(stderr, "Starting capture thread on core %d for %d victims...\n",
+            attackers[d].core, attackers[d].num_victims);
+    attackers[d].pid = spawn_pinned(attackers[d].core, path, NULL, argv);
+  }
+
+  for (int d = 0; d < num_attackers; d++) {
+    int status = -1;
+    if (attackers[d].num_victims == 0)
+      continue;
+    if (attackers[d].pid > 0)
+      waitpid(attackers[d].pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "Capture thread %d failed, see %s/attacker%d.log\n", d,
+              cfg->out_dir, d);
+      ret = 1;
+    }
+  }
+  stop_victims(victims, cfg->victims);
+  double wall_time = monotonic_seconds() - wall_start;
+  if (ret)
+    return ret;
+
+  for (int i = 0; i < cfg->victims; i++) {
+    bench_victim_t *v = &victims[i];
+    trace_file_t tf;
+    trace_record_t *trace;
+    rsa_truth_t truth;
+
+    if (load_scored_trace(v->trace_path, v->key_path, &tf, &trace, &truth,
+                          &v->score) < 0)
+      return 1;
+    size_t n = tf.header.num_slots;
+    v->engine = tf.header.engine;
+    for (size_t k = 0; k < n; k++)
+      v->missed += (trace[k].flags & TRACE_SLOT_MISSED) != 0;
+    v->slots_per_sec = n ? trace_slots_per_sec(&tf.header, trace, n) *
+                               (n - v->missed) / n
+                         : 0;
+    free(trace);
+    trace_close(&tf);
+    rsa_truth_free(&truth);
+  }
+
+  write_victims_summary(stdout, cfg, victims, attackers, num_attackers,
+                        wall_time);
+  FILE *json = fopen(cfg->json_path, "w");
+  if (json) {
+    write_victims_summary(json, cfg, victims, attackers, num_attackers,
+                          wall_time);
+    fclose(json);
+    fprintf(stderr, "Summary written to %s\n", cfg->json_path);
+  } else {
+    perror(cfg->json_path);
+  }
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--victim-core N] [--attacker-core N] [--slots N] "
+          "[--engine fr|pp|ff] [--level l1|llc]\n"
+          "          [--victims N] [--converge FRAC] [--out DIR] "
+          "[--json FILE]\n",
+          prog);
+  fprintf(stderr, "  --victim-core N    core for victim_rsa (default: 1)\n");
+  fprintf(stderr, "  --attacker-core N  core for attacker_rsa (default: 2)\n");
+  fprintf(stderr, "  --slots N          slots to capture (default: %d)\n",
+          DEFAULT_SLOTS);
+  fprintf(stderr, "  --engine NAME      attacker_rsa probe engine "
+                  "(default: fr)\n");
+  fprintf(stderr, "  --level NAME       cache for Prime+Probe "
+                  "(default: llc)\n");
+  fprintf(stderr, "  --victims N        N victims with their own library "
+                  "copies, one capture thread\n"
+                  "                     per LLC domain (up to %d)\n",
+          MAX_VICTIMS);
+  fprintf(stderr, "  --converge FRAC    stop the capture once FRAC of the "
+                  "online estimate is stable;\n"
+                  "                     --slots becomes the limit "
+                  "(single victim only)\n");
+  fprintf(stderr, "  --out DIR          logs, trace and key file (default: %s)\n",
+          DEFAULT_OUT_DIR);
+  fprintf(stderr, "  --json FILE        summary path (default: DIR/summary.json)\n");
+}
+
+int main(int argc, char *argv[]) {
+  bench_config_t cfg = {1, 2, DEFAULT_SLOTS, "fr", "llc", 0, NULL,
+                        DEFAULT_OUT_DIR, NULL};
+  char key_path[512], trace_path[512], json_path[512];
+  char victim_log[512], attacker_log[512], slots_arg[32];
+
+  static const struct option long_options[] = {
+      {"victim-core", required_argument, NULL, 'v'},
+      {"attacker-core", required_argument, NULL, 'a'},
+      {"slots", required_argument, NULL, 'S'},
+      {"engine", required_argument, NULL, 'e'},
+      {"level", required_argument, NULL, 'l'},
+      {"victims", required_argument, NULL, 'n'},
+      {"converge", required_argument, NULL, 'c'},
+      {"out", required_argument, NULL, 'o'},
+      {"json", required_argument, NULL, 'j'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "v:a:S:e:l:n:c:o:j:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'v':
+      cfg.victim_core = atoi(optarg);
+      break;
+    case 'a':
+      cfg.attacker_core = atoi(optarg);
+      break;
+    case 'S':
+      cfg.slots = atoi(optarg);
+      break;
+    case 'e':
+      cfg.engine = optarg;
+      break;
+    case 'l':
+      cfg.level = optarg;
+      break;
+    case 'n':
+      cfg.victims = atoi(optarg);
+      if (cfg.victims < 1 || cfg.victims > MAX_VICTIMS) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'c':
+      cfg.converge = optarg;
+      break;
+    case 'o':
+      cfg.out_dir = optarg;
+      break;
+    case 'j':
+      cfg.json_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (mkdir(cfg.out_dir, 0755) < 0 && errno != EEXIST) {
+    perror(cfg.out_dir);
+    return 1;
+  }
+  snprintf(key_path, sizeof(key_path), "%s/key.txt", cfg.out_dir);
+  snprintf(trace_path, sizeof(trace_path), "%s/trace.frt", cfg.out_dir);
+  snprintf(victim_log, sizeof(victim_log), "%s/victim.log", cfg.out_dir);
+  snprintf(attacker_log, sizeof(attacker_log), "%s/attacker.log", cfg.out_dir);
+  snprintf(json_path, sizeof(json_path), "%s/summary.json", cfg.out_dir);
+  if (!cfg.json_path)
+    cfg.json_path = json_path;
+  snprintf(slots_arg, sizeof(slots_arg), "%d", cfg.slots);
+
+  if (cfg.victims > 0)
+    return run_victims(&cfg);
+
+  double wall_start = monotonic_seconds();
+
+  char *victim_argv[] = {"./victim_rsa", "--status", STATUS_NAME,
+                         "--key-out",    key_path,   NULL};
+  fprintf(stderr, "Starting victim on core %d...\n", cfg.victim_core);
+  pid_t victim = spawn_pinned(cfg.victim_core, victim_log, NULL, victim_argv);
+  if (victim < 0) {
+    perror("fork");
+    return 1;
+  }
+
+  harness_status_t *status = harness_status_wait(STATUS_NAME, READY_TIMEOUT_MS);
+  if (!status || waitpid(victim, NULL, WNOHANG) != 0) {
+    fprintf(stderr, "Victim did not become ready, see %s\n", victim_log);
+    kill(victim, SIGTERM);
+    waitpid(victim, NULL, 0);
+    harness_status_close(status);
+    return 1;
+  }
+  harness_status_close(status);
+
+  char *attacker_argv[] = {"./attacker_rsa", "--status", STATUS_NAME,
+                           "--output",       trace_path, "--slots",
+                           slots_arg,        "--engine", (char *)cfg.engine,
+                           "--level",        (char *)cfg.level,
+                           "--quiet",        NULL,       NULL,
+                           NULL};
+  if (cfg.converge) {
+    attacker_argv[12] = "--converge";
+    attacker_argv[13] = (char *)cfg.converge;
+  }
+  fprintf(stderr, "Starting attacker on core %d for %d slots...\n",
+          cfg.attacker_core, cfg.slots);
+  pid_t attacker = spawn_pinned(cfg.attacker_core, attacker_log, NULL, attacker_argv);
+  int attacker_status = -1;
+  if (attacker > 0)
+    waitpid(attacker, &attacker_status, 0);
+
+  kill(victim, SIGTERM);
+  waitpid(victim, NULL, 0);
+  double wall_time = monotonic_seconds() - wall_start;
+
+  if (!WIFEXITED(attacker_status) || WEXITSTATUS(attacker_status) != 0) {
+    fprintf(stderr, "Attacker failed, see %s\n", attacker_log);
+    return 1;
+  }
+
+  return score_run(&cfg, trace_path, key_path, wall_time) < 0 ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+#include <dlfcn.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "harness.h"
+#include "probe.h"
+
+// Receiver half of the covert channel benchmark. The line is reloaded three
+// quarters into each symbol, after the sender's active half, and flushed
+// right after the reload, so each probe sees the accesses since the previous
+// symbol's probe: the last quarter of that symbol and the first three
+// quarters of this one. Errors against the published payload give the per-host noise
+// figure: raw bandwidth, bit error rate and binary symmetric channel capacity
+// for every symbol duration of the sender's sweep.
+
+#define CHANNEL_OFFSET 0x0000000000036d60 // _gcry_camellia_encrypt128
+#define MAX_STEPS 32
+#define WAIT_TIMEOUT_MS 60000
+
+typedef struct {
+  uint64_t period;
+  uint64_t symbols;
+  uint64_t errors;
+  uint64_t late; // probes issued after the sender's next symbol began
+} step_result_t;
+
+volatile int running = 1;
+static uint64_t threshold = PROBE_RELOAD_THRESHOLD; // until calibrated
+
+void signal_handler(int sig) { running = 0; }
+
+// Same Flush+Reload primitive as attacker_rsa
+static inline int probe(void *addr, uint64_t *time_measured) {
+  *time_measured = probe_reload(PROBE_TIMER_RDTSC, addr);
+  return *time_measured < threshold;
+}
+
+static double binary_entropy(double p) {
+  if (p <= 0.0 || p >= 1.0)
+    return 0.0;
+  return -p * log2(p) - (1 - p) * log2(1 - p);
+}
+
+// Receive one sweep step and count symbol errors
+void receive_step(void *line, harness_status_t *status, step_result_t *res) {
+  uint64_t t0 = status->bit_t0;
+  uint64_t period = status->bit_period;
+  uint64_t state = status->bit_seed;
+  uint64_t time;
+
+  res->period = period;
+  res->symbols = 0;
+  res->errors = 0;
+  res->late = 0;
+
+  for (uint64_t k = 0; k < status->bit_count && running; k++) {
+    uint64_t start = t0 + k * period;
+    uint64_t sample = start + period * 3 / 4;
+
+    while (harness_rdtsc() < sample)
+      ;
+    int late = harness_rdtsc() >= start + period;
+    int bit = probe(line, &time);
+
+    res->symbols++;
+    res->late += late;
+    if (bit != harness_next_bit(&state) || late)
+      res->errors++;
+  }
+}
+
+// The channel's error rate is the figure this benchmark reports, so the
+// threshold is the midpoint of this host's hit and miss reload latencies
+static void calibrate_threshold(void) {
+  probe_calibration_t cal;
+
+  probe_timer_calibrate(PROBE_TIMER_RDTSC, &cal);
+  printf("Reload: hit %lu / miss %lu cycles", cal.hit_median, cal.miss_median);
+  if (cal.miss_median <= cal.hit_median + 1) {
+    printf("\n");
+    fprintf(stderr, "Warning: reload times do not separate, using threshold "
+                    "%lu\n",
+            threshold);
+    return;
+  }
+  threshold = (cal.hit_median + cal.miss_median + 1) / 2;
+  printf(", threshold %lu\n", threshold);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [--status NAME]\n", prog);
+  fprintf(stderr, "  --status NAME  sender status page name (default: covert)\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *status_name = "covert";
+  step_result_t results[MAX_STEPS];
+  int num_steps = 0;
+
+  static const struct option long_options[] = {
+      {"status", required_argument, NULL, 's'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:h", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 's':
+      status_name = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  printf("Covert channel receiver (PID: %d)\n", getpid());
+  calibrate_threshold();
+
+  signal(SIGTERM, signal_handler);
+  signal(SIGINT, signal_handler);
+
+  void *lib_handle = dlopen("./lib/libgcrypt.so.11.6.0", RTLD_NOW);
+  if (!lib_handle) {
+    fprintf(stderr, "Failed to load libgcrypt: %s\n", dlerror());
+    return 1;
+  }
+
+  void *base_addr = harness_library_base("libgcrypt.so");
+  if (!base_addr) {
+    fprintf(stderr, "Failed to get library base address\n");
+    dlclose(lib_handle);
+    return 1;
+  }
+  void *line = (char *)base_addr + CHANNEL_OFFSET;
+
+  printf("Waiting for covert_sender...\n");
+  harness_status_t *status = harness_status_wait(status_name, WAIT_TIMEOUT_MS);
+  if (!status) {
+    dlclose(lib_handle);
+    return 1;
+  }
+  printf("Shared line: %p, waiting for sender steps...\n", line);
+
+  // Each step is bracketed by an odd op_seq; join at the next step start
+  uint64_t seen = harness_op_seq(status);
+  if (!(seen & 1))
+    seen = 0;
+  while (running && !status->finished && num_steps < MAX_STEPS) {
+    uint64_t seq = harness_op_seq(status);
+    if (!(seq & 1) || seq == seen) {
+      usleep(100);
+      continue;
+    }
+    seen = seq;
+
+    uint64_t time;
+    probe(line, &time); // start from a flushed line
+    receive_step(line, status, &results[num_steps]);
+    if (harness_op_seq(status) != seq && harness_op_seq(status) != seq + 1)
+      fprintf(stderr, "Warning: step %d overlapped the next one\n", num_steps);
+    printf("Step %d: %lu cycles per symbol received\n", num_steps,
+           results[num_steps].period);
+    num_steps++;
+  }
+
+  printf("\n=== COVERT CHANNEL RESULTS ===\n");
+  printf("TSC: %.3f GHz, hit threshold %lu cycles\n", status->tsc_hz / 1e9,
+         threshold);
+  printf("%10s %10s %12s %10s %8s %12s\n", "cycles", "ns", "raw bit/s",
+         "errors", "late", "capacity");
+  for (int i = 0; i < num_steps; i++) {
+    step_result_t *r = &results[i];
+    if (r->symbols == 0)
+      continue;
+    double error_rate = (double)r->errors / r->symbols;
+    double raw = (double)status->tsc_hz / r->period;
+    printf("%10lu %10.0f %12.0f %9.4f%% %8lu %12.0f\n", r->period,
+           r->period * 1e9 / status->tsc_hz, raw, error_rate * 100, r->late,
+           raw * (1 - binary_entropy(error_rate)));
+  }
+
+  harness_status_close(status);
+  dlclose(lib_handle);
+  return 0;
+}
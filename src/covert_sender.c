@@ -0,0 +1,154 @@
+#include <dlfcn.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "harness.h"
+
+// Sender half of a Flush+Reload covert channel over one shared line of the
+// bundled library. A 1 is sent by loading the line during the first half of
+// the symbol, a 0 by staying idle. Symbol timing and the payload seed are
+// published on the status page so the receiver can score every symbol; the
+// benchmark measures the channel, not a synchronisation protocol.
+
+#define CHANNEL_OFFSET 0x0000000000036d60 // _gcry_camellia_encrypt128
+#define DEFAULT_SYMBOLS 20000
+#define DEFAULT_SEED 0xc0c0c0c0ULL
+#define MAX_STEPS 32
+#define START_DELAY_MS 200 // lets a waiting receiver attach
+#define STEP_LEAD_MS 20     // gap before each sweep step starts
+
+static const uint64_t default_sweep[] = {1000,  2000,  5000,   10000,
+                                         20000, 50000, 100000, 200000};
+
+volatile int running = 1;
+
+void signal_handler(int sig) { running = 0; }
+
+// Parse a comma separated list of symbol durations in cycles
+int parse_sweep(char *arg, uint64_t *sweep) {
+  int n = 0;
+  for (char *tok = strtok(arg, ","); tok && n < MAX_STEPS;
+       tok = strtok(NULL, ","))
+    sweep[n++] = strtoull(tok, NULL, 0);
+  return n;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [--symbols N] [--sweep C1,C2,...] [--status NAME]\n",
+          prog);
+  fprintf(stderr, "  --symbols N    symbols sent per duration (default: %d)\n",
+          DEFAULT_SYMBOLS);
+  fprintf(stderr, "  --sweep LIST   symbol durations in cycles\n");
+  fprintf(stderr, "  --status NAME  status page name (default: covert)\n");
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t sweep[MAX_STEPS];
+  int num_steps = sizeof(default_sweep) / sizeof(default_sweep[0]);
+  uint64_t symbols = DEFAULT_SYMBOLS;
+  const char *status_name = "covert";
+
+  memcpy(sweep, default_sweep, sizeof(default_sweep));
+
+  static const struct option long_options[] = {
+      {"symbols", required_argument, NULL, 'n'},
+      {"sweep", required_argument, NULL, 'w'},
+      {"status", required_argument, NULL, 's'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:w:s:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'n':
+      symbols = strtoull(optarg, NULL, 0);
+      break;
+    case 'w':
+      num_steps = parse_sweep(optarg, sweep);
+      break;
+    case 's':
+      status_name = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (num_steps == 0 || symbols == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  printf("Covert channel sender (PID: %d)\n", getpid());
+
+  signal(SIGTERM, signal_handler);
+  signal(SIGINT, signal_handler);
+
+  void *lib_handle = dlopen("./lib/libgcrypt.so.11.6.0", RTLD_NOW);
+  if (!lib_handle) {
+    fprintf(stderr, "Failed to load libgcrypt: %s\n", dlerror());
+    return 1;
+  }
+
+  void *base_addr = harness_library_base("libgcrypt.so");
+  if (!base_addr) {
+    fprintf(stderr, "Failed to get library base address\n");
+    dlclose(lib_handle);
+    return 1;
+  }
+  volatile char *line = (char *)base_addr + CHANNEL_OFFSET;
+
+  harness_status_t *status = harness_status_create(status_name);
+  if (!status) {
+    dlclose(lib_handle);
+    return 1;
+  }
+  status->tsc_hz = harness_tsc_hz();
+  status->bit_count = symbols;
+  status->ready = 1;
+
+  printf("Shared line: %p, TSC %.3f GHz\n", (void *)line,
+         status->tsc_hz / 1e9);
+  printf("Sending %lu symbols per step over %d steps\n", symbols, num_steps);
+  usleep(START_DELAY_MS * 1000);
+
+  for (int step = 0; step < num_steps && running; step++) {
+    uint64_t period = sweep[step];
+    uint64_t state = DEFAULT_SEED + step;
+
+    status->bit_seed = state;
+    status->bit_period = period;
+    status->bit_t0 = harness_rdtsc() + status->tsc_hz / 1000 * STEP_LEAD_MS;
+    harness_op_begin(status, step);
+
+    uint64_t t0 = status->bit_t0;
+    for (uint64_t k = 0; k < symbols && running; k++) {
+      uint64_t start = t0 + k * period;
+      while (harness_rdtsc() < start)
+        ;
+
+      if (harness_next_bit(&state)) {
+        while (harness_rdtsc() < start + period / 2)
+          (void)*line;
+      }
+    }
+    while (harness_rdtsc() < t0 + symbols * period)
+      ;
+
+    harness_op_end(status);
+    printf("Step %d: %lu cycles per symbol sent\n", step, period);
+  }
+
+  status->finished = 1;
+  // Give the receiver time to see the final state before the page goes away
+  usleep(100000);
+  harness_status_close(status);
+  dlclose(lib_handle);
+  return 0;
+}
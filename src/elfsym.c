@@ -0,0 +1,82 @@
+#include "elfsym.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int search_table(const uint8_t *image, size_t len, const Elf64_Shdr *sh,
+                        const Elf64_Shdr *strtab, const char *name,
+                        uint64_t *value, uint64_t *size) {
+  if (sh->sh_offset + sh->sh_size > len ||
+      strtab->sh_offset + strtab->sh_size > len || sh->sh_entsize == 0)
+    return -1;
+
+  const char *strings = (const char *)image + strtab->sh_offset;
+  size_t count = sh->sh_size / sh->sh_entsize;
+
+  for (size_t i = 0; i < count; i++) {
+    const Elf64_Sym *sym =
+        (const Elf64_Sym *)(image + sh->sh_offset + i * sh->sh_entsize);
+    if (sym->st_name >= strtab->sh_size || sym->st_shndx == SHN_UNDEF)
+      continue;
+    if (strcmp(strings + sym->st_name, name) == 0) {
+      *value = sym->st_value;
+      *size = sym->st_size;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+int elf_symbol_lookup(const char *path, const char *name, uint64_t *value,
+                      uint64_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  const uint8_t *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+
+  int found = -1;
+  const Elf64_Ehdr *eh = (const Elf64_Ehdr *)image;
+  if ((size_t)st.st_size < sizeof(*eh) ||
+      memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+      eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+      eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) >
+          (uint64_t)st.st_size) {
+    fprintf(stderr, "%s: not an ELF64 file\n", path);
+    goto out;
+  }
+
+  const Elf64_Shdr *sections = (const Elf64_Shdr *)(image + eh->e_shoff);
+  const uint32_t order[] = {SHT_SYMTAB, SHT_DYNSYM};
+  for (int t = 0; t < 2 && found < 0; t++) {
+    for (int i = 0; i < eh->e_shnum && found < 0; i++) {
+      if (sections[i].sh_type != order[t] ||
+          sections[i].sh_link >= eh->e_shnum)
+        continue;
+      found = search_table(image, st.st_size, &sections[i],
+                           &sections[sections[i].sh_link], name, value, size);
+    }
+  }
+
+out:
+  munmap((void *)image, st.st_size);
+  return found;
+}
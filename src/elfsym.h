@@ -0,0 +1,13 @@
+#ifndef ELFSYM_H
+#define ELFSYM_H
+
+#include <stdint.h>
+
+// Look up a symbol in the symbol table of an ELF64 file. Local symbols such
+// as the AES T-tables only appear in .symtab, so that table is searched
+// first, then .dynsym. value is the symbol's virtual address, which for a
+// shared library is its offset from the load base.
+int elf_symbol_lookup(const char *path, const char *name, uint64_t *value,
+                      uint64_t *size);
+
+#endif
@@ -0,0 +1,352 @@
+#define _GNU_SOURCE
+#include "evset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define PAGE_SIZE 4096UL
+#define HUGE_PAGE_SIZE (2UL << 20)
+#define EVICT_VOTES 3         // eviction tests are a majority of this many
+#define REDUCE_RETRIES 8      // failed rounds tolerated before giving up
+#define CALIBRATION_PROBES 2000
+
+static int read_sysfs(int index, const char *field, char *buf, size_t len) {
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/%s",
+           index, field);
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return -1;
+  int ok = fgets(buf, len, f) != NULL;
+  fclose(f);
+  if (!ok)
+    return -1;
+  buf[strcspn(buf, "\n")] = '\0';
+  return 0;
+}
+
+int cache_info(int level, cache_info_t *info) {
+  char buf[64];
+  int found = -1, best_level = 0;
+
+  for (int i = 0; read_sysfs(i, "level", buf, sizeof(buf)) == 0; i++) {
+    int l = atoi(buf);
+    if (read_sysfs(i, "type", buf, sizeof(buf)) < 0)
+      continue;
+    if (level == CACHE_L1D ? l == 1 && strcmp(buf, "Data") == 0
+                           : l > best_level && strcmp(buf, "Instruction") != 0) {
+      found = i;
+      best_level = l;
+    }
+  }
+  if (found < 0)
+    return -1;
+
+  memset(info, 0, sizeof(*info));
+  if (read_sysfs(found, "size", buf, sizeof(buf)) == 0) {
+    char *end;
+    info->size = strtoul(buf, &end, 10);
+    if (*end == 'K')
+      info->size <<= 10;
+    else if (*end == 'M')
+      info->size <<= 20;
+  }
+  if (read_sysfs(found, "ways_of_associativity", buf, sizeof(buf)) == 0)
+    info->ways = atoi(buf);
+  if (read_sysfs(found, "number_of_sets", buf, sizeof(buf)) == 0)
+    info->sets = atoi(buf);
+  if (read_sysfs(found, "coherency_line_size", buf, sizeof(buf)) == 0)
+    info->line = atoi(buf);
+  return info->size && info->ways && info->sets && info->line ? 0 : -1;
+}
+
+// Bytes of [mem, mem + len) backed by transparent huge pages: whole 2 MB
+// ranges whose pages are all resident and that the kernel reports as huge
+static size_t thp_backed(char *mem, size_t len) {
+  FILE *f = fopen("/proc/self/smaps", "r");
+  char line[256];
+  unsigned long lo, hi;
+  int inside = 0;
+  size_t kb = 0;
+
+  if (!f)
+    return 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+      inside = lo < (uintptr_t)mem + len && hi > (uintptr_t)mem;
+    else if (inside && strncmp(line, "AnonHugePages:", 14) == 0)
+      kb += strtoul(line + 14, NULL, 10);
+  }
+  fclose(f);
+  return kb << 10;
+}
+
+int evset_pool_alloc(evset_pool_t *pool, size_t bytes, int hugepages) {
+  void *mem = MAP_FAILED;
+
+  memset(pool, 0, sizeof(*pool));
+  if (hugepages) {
+    pool->bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    mem = mmap(NULL, pool->bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+               0);
+    pool->hugetlb = mem != MAP_FAILED;
+  }
+  if (mem == MAP_FAILED && hugepages) {
+    // No reserved huge pages: map 2 MB aligned and ask for THP before the
+    // first touch, so the faults below allocate huge pages directly
+    char *raw = mmap(NULL, pool->bytes + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      perror("mmap eviction pool");
+      return -1;
+    }
+    char *aligned = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) &
+                             ~(HUGE_PAGE_SIZE - 1));
+    if (aligned > raw)
+      munmap(raw, aligned - raw);
+    munmap(aligned + pool->bytes, raw + HUGE_PAGE_SIZE - aligned);
+    madvise(aligned, pool->bytes, MADV_HUGEPAGE);
+    mem = aligned;
+  } else if (mem == MAP_FAILED) {
+    pool->bytes = (bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    mem = mmap(NULL, pool->bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mem == MAP_FAILED) {
+      perror("mmap eviction pool");
+      return -1;
+    }
+  }
+
+  // Write every page so each is backed by its own frame, not the zero page
+  for (size_t off = 0; off < pool->bytes; off += PAGE_SIZE)
+    ((volatile char *)mem)[off] = 1;
+  if (hugepages && !pool->hugetlb)
+    pool->thp_bytes = thp_backed(mem, pool->bytes);
+
+  pool->base = mem;
+  if (evset_pool_set_stride(pool, PAGE_SIZE) < 0) {
+    munmap(mem, pool->bytes);
+    pool->base = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+int evset_pool_set_stride(evset_pool_t *pool, size_t stride) {
+  if (stride < PAGE_SIZE || stride & (stride - 1))
+    return -1;
+  if (stride > PAGE_SIZE &&
+      (stride > HUGE_PAGE_SIZE ||
+       (!pool->hugetlb && pool->thp_bytes < pool->bytes)))
+    return -1;
+
+  uint8_t *used = calloc(pool->bytes / stride, 1);
+  if (!used)
+    return -1;
+  free(pool->used);
+  pool->used = used;
+  pool->stride = stride;
+  pool->strides = pool->bytes / stride;
+  return 0;
+}
+
+void evset_pool_free(evset_pool_t *pool) {
+  if (!pool->base)
+    return;
+  munmap(pool->base, pool->bytes);
+  free(pool->used);
+  pool->used = NULL;
+  pool->base = NULL;
+}
+
+// Candidate for target in stride k: the line at the target's offset
+static char *candidate(const evset_pool_t *pool, size_t k,
+                       const void *target) {
+  return pool->base + k * pool->stride +
+         ((uintptr_t)target & (pool->stride - 1) & ~63UL);
+}
+
+// Link the chosen lines into a ring and mark their pages used
+static int evset_finish(evset_t *set, evset_pool_t *pool, char **lines,
+                        unsigned count) {
+  set->lines = malloc(count * sizeof(*set->lines));
+  if (!set->lines)
+    return -1;
+  memcpy(set->lines, lines, count * sizeof(*lines));
+  set->count = count;
+  for (unsigned i = 0; i < count; i++) {
+    void **line = (void **)lines[i];
+    line[0] = lines[(i + 1) % count];
+    line[1] = lines[(i + count - 1) % count];
+    pool->used[(lines[i] - pool->base) / pool->stride] = 1;
+  }
+  return 0;
+}
+
+int evset_build_l1d(evset_t *set, evset_pool_t *pool, const void *target,
+                    const cache_info_t *l1) {
+  char *lines[l1->ways];
+  unsigned n = 0;
+  uint64_t start = probe_rdtsc();
+
+  memset(set, 0, sizeof(*set));
+  for (size_t k = 0; k < pool->strides && n < l1->ways; k++) {
+    if (!pool->used[k])
+      lines[n++] = candidate(pool, k, target);
+  }
+  if (n < l1->ways)
+    return -1;
+  if (evset_finish(set, pool, lines, n) < 0)
+    return -1;
+  set->build_cycles = probe_rdtsc() - start;
+  return 0;
+}
+
+// Does walking lines[0..n) evict target? Load the target, walk the candidates
+// twice so replacement state settles, then time a reload of the target.
+static int evicts(const void *target, char **lines, size_t n,
+                  uint64_t miss_threshold) {
+  int votes = 0;
+
+  for (int v = 0; v < EVICT_VOTES; v++) {
+    (void)*(const volatile char *)target;
+    for (int pass = 0; pass < 2; pass++) {
+      for (size_t i = 0; i < n; i++)
+        (void)*(volatile char *)lines[i];
+    }
+    // The walk also evicts the target's TLB entry: refill it through the
+    // other half of the page so the reload times the cache alone
+    (void)*(const volatile char *)((uintptr_t)target ^ (PAGE_SIZE / 2));
+    votes += probe_load_time(PROBE_TIMER_RDTSC, target) > miss_threshold;
+  }
+  return votes * 2 > EVICT_VOTES;
+}
+
+typedef struct {
+  const void *target;
+  uint64_t miss_threshold;
+} evicts_arg_t;
+
+static int evicts_target(char **lines, size_t n, void *arg) {
+  const evicts_arg_t *e = arg;
+  return evicts(e->target, lines, n, e->miss_threshold);
+}
+
+long evset_reduce(char **cand, size_t n, unsigned ways, evset_test_fn test,
+                  void *arg, unsigned *tests) {
+  int retries = 0;
+
+  // Candidates without the group under test; cand itself only changes when
+  // a group is dropped, so every group of a round is the one it started as
+  char **rest = malloc((n ? n : 1) * sizeof(*rest));
+  if (!rest)
+    return -1;
+
+  // Each round tests the candidates without one group at a time; a group
+  // whose removal still evicts is dropped. ways + 1 groups guarantee one of
+  // them holds no congruent line, so every round shrinks the set by a
+  // fraction.
+  while (n > ways) {
+    size_t groups = ways + 1;
+    int dropped = 0;
+
+    for (size_t g = 0; g < groups && !dropped; g++) {
+      size_t lo = n * g / groups, hi = n * (g + 1) / groups;
+      size_t len = hi - lo;
+      if (len == 0)
+        continue;
+
+      memcpy(rest, cand, lo * sizeof(*rest));
+      memcpy(rest + lo, cand + hi, (n - hi) * sizeof(*rest));
+      (*tests)++;
+      if (test(rest, n - len, arg)) {
+        memcpy(cand, rest, (n - len) * sizeof(*cand));
+        n -= len;
+        dropped = 1;
+      }
+    }
+
+    if (!dropped && ++retries > REDUCE_RETRIES) {
+      free(rest);
+      return -1;
+    }
+  }
+
+  free(rest);
+  return n;
+}
+
+int evset_build_llc(evset_t *set, evset_pool_t *pool, const void *target,
+                    const cache_info_t *llc, uint64_t miss_threshold) {
+  size_t n = 0;
+  evicts_arg_t arg = {target, miss_threshold};
+  uint64_t start = probe_rdtsc();
+
+  memset(set, 0, sizeof(*set));
+  char **cand = malloc(pool->strides * sizeof(*cand));
+  if (!cand)
+    return -1;
+  for (size_t k = 0; k < pool->strides; k++) {
+    if (!pool->used[k])
+      cand[n++] = candidate(pool, k, target);
+  }
+
+  set->tests++;
+  if (!evicts_target(cand, n, &arg)) {
+    free(cand);
+    return -1;
+  }
+
+  long left = evset_reduce(cand, n, llc->ways, evicts_target, &arg,
+                           &set->tests);
+  int ret = left < 0 ? -1 : evset_finish(set, pool, cand, left);
+  free(cand);
+  set->build_cycles = probe_rdtsc() - start;
+  return ret;
+}
+
+uint64_t evset_miss_threshold(void) {
+  probe_calibration_t tsc;
+
+  probe_timer_calibrate(PROBE_TIMER_RDTSC, &tsc);
+  return tsc.hit_median + 3 * (tsc.miss_median - tsc.hit_median) / 4;
+}
+
+int evset_verify(const evset_t *set, const void *target,
+                 uint64_t miss_threshold) {
+  return set->count && evicts(target, set->lines, set->count, miss_threshold);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+int evset_calibrate(evset_t *set, probe_timer_t timer, const void *target) {
+  uint64_t samples[CALIBRATION_PROBES];
+
+  evset_prime(set);
+  for (int i = 0; i < CALIBRATION_PROBES; i++)
+    samples[i] = evset_probe(timer, set);
+  qsort(samples, CALIBRATION_PROBES, sizeof(*samples), compare_u64);
+  set->idle_median = samples[CALIBRATION_PROBES / 2];
+
+  for (int i = 0; i < CALIBRATION_PROBES; i++) {
+    (void)*(const volatile char *)target;
+    samples[i] = evset_probe(timer, set);
+  }
+  qsort(samples, CALIBRATION_PROBES, sizeof(*samples), compare_u64);
+  set->active_median = samples[CALIBRATION_PROBES / 2];
+
+  set->threshold = (set->idle_median + set->active_median) / 2;
+  return set->active_median > set->idle_median ? 0 : -1;
+}
+
+void evset_free(evset_t *set) {
+  free(set->lines);
+  set->lines = NULL;
+  set->count = 0;
+}
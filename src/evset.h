@@ -0,0 +1,132 @@
+#ifndef EVSET_H
+#define EVSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "probe.h"
+
+// Eviction sets for Prime+Probe.
+//
+// An eviction set is a group of lines in the attacker's own memory that map
+// to the same cache set as a target. Priming fills the set with them; a later
+// timed walk over the set is slow if anything else (the victim) used the set
+// in between. No shared pages and no clflush are needed for the measurement.
+//
+// Construction here takes a lab shortcut: the target is a line the attacker
+// can load (the shared library line Flush+Reload would monitor), and eviction
+// is tested by timing reloads of it. Only the build uses the target; probing
+// touches the attacker's lines alone.
+
+typedef struct {
+  size_t size;   // bytes
+  unsigned ways;
+  unsigned sets; // all slices together
+  unsigned line;
+} cache_info_t;
+
+#define CACHE_L1D 1
+#define CACHE_LLC 0
+
+// Geometry of the L1 data cache (CACHE_L1D) or the last level cache
+// (CACHE_LLC) of cpu0, from sysfs.
+int cache_info(int level, cache_info_t *info);
+
+// Candidate memory, cut into strides of equal size. Candidates for a target
+// sit at the target's offset within every stride; strides handed out to a
+// set are marked used so several sets can be built from one pool.
+//
+// With 4 KB pages only the page offset is known to match the target's
+// physical address, so the stride is a page. A pool on 2 MB pages can use a
+// stride of one LLC slice's worth of sets: every candidate then shares the
+// target's set index, and only the slice is left to find by reduction.
+typedef struct {
+  char *base;
+  size_t bytes;
+  size_t stride;
+  size_t strides;
+  uint8_t *used;
+  int hugetlb;     // backed by 2 MB hugetlbfs pages
+  size_t thp_bytes; // bytes backed by transparent huge pages otherwise
+} evset_pool_t;
+
+// A pool on 4 KB pages, or with hugepages on 2 MB hugetlbfs pages, falling
+// back to transparent huge pages. stride must divide the page size used.
+int evset_pool_alloc(evset_pool_t *pool, size_t bytes, int hugepages);
+// Use a stride larger than 4 KB; fails unless every stride lies within one
+// huge page.
+int evset_pool_set_stride(evset_pool_t *pool, size_t stride);
+void evset_pool_free(evset_pool_t *pool);
+
+typedef struct {
+  char **lines;
+  unsigned count;
+  uint64_t threshold;    // probe time above which the set saw foreign use
+  uint64_t idle_median;  // probe time with no other access, timer units
+  uint64_t active_median; // probe time after one target access
+  uint64_t build_cycles; // TSC cycles spent building the set
+  unsigned tests;        // eviction tests run while building
+} evset_t;
+
+// L1D sets are selected by page offset bits alone: take one line from each
+// of `ways` unused strides at the target's offset.
+int evset_build_l1d(evset_t *set, evset_pool_t *pool, const void *target,
+                    const cache_info_t *l1);
+
+// Group-testing reduction (Vila et al.): start from every unused stride's
+// line at the target's offset, split the candidates into ways + 1 groups and drop
+// any group whose removal still evicts the target, until `ways` lines are
+// left. miss_threshold separates cached from evicted reloads of the target
+// in rdtsc cycles.
+int evset_build_llc(evset_t *set, evset_pool_t *pool, const void *target,
+                    const cache_info_t *llc, uint64_t miss_threshold);
+
+// Eviction test used by the reduction: does walking lines[0..n) evict the
+// target?
+typedef int (*evset_test_fn)(char **lines, size_t n, void *arg);
+
+// The reduction behind evset_build_llc, on any eviction test. Shrinks
+// cand[0..n) in place to at most `ways` lines that still pass test and
+// returns how many are left, or -1 if too many rounds drop nothing. tests
+// counts the calls to test.
+long evset_reduce(char **cand, size_t n, unsigned ways, evset_test_fn test,
+                  void *arg, unsigned *tests);
+
+// Reload threshold for eviction tests, from rdtsc hit and miss medians. An
+// LLC eviction has to reach DRAM, and reloads served by the LLC itself fall
+// between a cached and a flushed line, so the cut sits close to the flushed
+// time.
+uint64_t evset_miss_threshold(void);
+
+// Does walking the set evict target? A majority of fresh eviction tests.
+int evset_verify(const evset_t *set, const void *target,
+                 uint64_t miss_threshold);
+
+// Measure idle and target-touched probe times and set the threshold between
+// them. Returns -1 if the two do not separate.
+int evset_calibrate(evset_t *set, probe_timer_t timer, const void *target);
+
+void evset_free(evset_t *set);
+
+// Prime: walk the set forwards. Every line stores pointers to its successor
+// and predecessor, so the walk is a dependent pointer chase.
+static inline void evset_prime(const evset_t *set) {
+  void *p = set->lines[0];
+  for (unsigned i = 0; i < set->count; i++)
+    p = *(void **)p;
+  asm volatile("" : : "r"(p));
+}
+
+// Probe: time a backward walk, which also primes the set for the next probe.
+// Walking against the priming order keeps the probe from evicting the lines
+// it has yet to visit.
+static inline uint64_t evset_probe(probe_timer_t timer, const evset_t *set) {
+  uint64_t start = probe_begin(timer);
+  void *p = set->lines[set->count - 1];
+  for (unsigned i = 0; i < set->count; i++)
+    p = ((void **)p)[1];
+  asm volatile("" : : "r"(p));
+  return probe_end(timer) - start;
+}
+
+#endif
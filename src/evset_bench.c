@@ -0,0 +1,280 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "evset.h"
+#include "harness.h"
+
+// Benchmark of LLC eviction set construction.
+//
+// Every thread owns a candidate pool of twice the LLC and a 2 MB target
+// buffer, both on huge pages when available, and builds eviction sets for
+// random target lines with the group-testing reduction. On huge pages the
+// candidates are one LLC slice's worth of sets apart, so they already share
+// the target's set index and only the slice has to be found. Each set is
+// verified with fresh eviction tests and then discarded.
+
+#define DEFAULT_SETS 16
+#define DEFAULT_SETS_PER_SLICE 2048
+#define TARGET_BYTES (2UL << 20)
+
+typedef struct {
+  int id;
+  int sets;
+  size_t pool_bytes;
+  int hugepages;
+  unsigned sets_per_slice;
+  const cache_info_t *llc;
+  uint64_t miss_threshold;
+
+  // Results
+  evset_pool_t pool;
+  evset_pool_t targets;
+  uint64_t *build_cycles; // per successful set
+  int built;
+  int verified;
+  uint64_t tests;
+  int error;
+} worker_t;
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *pool_backing(const evset_pool_t *pool) {
+  static char desc[64];
+
+  if (pool->hugetlb)
+    return "hugetlb";
+  if (pool->thp_bytes == 0)
+    return "4K pages";
+  snprintf(desc, sizeof(desc), "THP %zu of %zu MB", pool->thp_bytes >> 20,
+           pool->bytes >> 20);
+  return desc;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *w = arg;
+  unsigned seed = 0x5eed + w->id;
+
+  if (evset_pool_alloc(&w->pool, w->pool_bytes, w->hugepages) < 0 ||
+      evset_pool_alloc(&w->targets, TARGET_BYTES, w->hugepages) < 0) {
+    w->error = 1;
+    return NULL;
+  }
+  size_t stride = (size_t)w->sets_per_slice * w->llc->line;
+  if (w->hugepages) {
+    int huge = w->targets.hugetlb || w->targets.thp_bytes == w->targets.bytes;
+    if ((!huge || evset_pool_set_stride(&w->pool, stride) < 0) && w->id == 0)
+      fprintf(stderr, "Pool not fully on huge pages, using 4K strides\n");
+  }
+
+  for (int i = 0; i < w->sets; i++) {
+    const char *target =
+        w->targets.base + (rand_r(&seed) % (TARGET_BYTES / 64)) * 64;
+    evset_t set;
+
+    // Sets are discarded after verification, so every build starts from
+    // the whole pool
+    memset(w->pool.used, 0, w->pool.strides);
+    int ret = evset_build_llc(&set, &w->pool, target, w->llc,
+                              w->miss_threshold);
+    w->tests += set.tests;
+    if (ret < 0)
+      continue;
+    w->build_cycles[w->built++] = set.build_cycles;
+    w->verified += evset_verify(&set, target, w->miss_threshold);
+    evset_free(&set);
+  }
+  return NULL;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--sets N] [--threads N] [--small-pages] "
+          "[--sets-per-slice N] [--pool-mb N]\n",
+          prog);
+  fprintf(stderr, "  --sets N            sets to build per thread "
+                  "(default: %d)\n",
+          DEFAULT_SETS);
+  fprintf(stderr, "  --threads N         build in N threads at once, pinned "
+                  "round-robin (default: 1)\n");
+  fprintf(stderr, "  --small-pages       4K page pool instead of huge pages\n");
+  fprintf(stderr, "  --sets-per-slice N  LLC sets per slice, the candidate "
+                  "stride on huge pages (default: %d)\n",
+          DEFAULT_SETS_PER_SLICE);
+  fprintf(stderr, "  --pool-mb N         candidate pool per thread "
+                  "(default: twice the LLC)\n");
+}
+
+int main(int argc, char *argv[]) {
+  int sets = DEFAULT_SETS;
+  int threads = 1;
+  int hugepages = 1;
+  unsigned sets_per_slice = DEFAULT_SETS_PER_SLICE;
+  size_t pool_mb = 0;
+  cache_info_t llc;
+
+  static const struct option long_options[] = {
+      {"sets", required_argument, NULL, 'n'},
+      {"threads", required_argument, NULL, 'j'},
+      {"small-pages", no_argument, NULL, 's'},
+      {"sets-per-slice", required_argument, NULL, 'p'},
+      {"pool-mb", required_argument, NULL, 'm'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:j:sp:m:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'n':
+      sets = atoi(optarg);
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 's':
+      hugepages = 0;
+      break;
+    case 'p':
+      sets_per_slice = atoi(optarg);
+      break;
+    case 'm':
+      pool_mb = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (sets <= 0 || threads <= 0 || sets_per_slice == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (cache_info(CACHE_LLC, &llc) < 0) {
+    fprintf(stderr, "Cannot read the LLC geometry from sysfs\n");
+    return 1;
+  }
+  size_t pool_bytes = pool_mb ? pool_mb << 20 : 2 * llc.size;
+  uint64_t miss_threshold = evset_miss_threshold();
+  uint64_t tsc_hz = harness_tsc_hz();
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  printf("LLC: %zu KB, %u ways, %u sets (%u slices of %u sets)\n",
+         llc.size >> 10, llc.ways, llc.sets, llc.sets / sets_per_slice,
+         sets_per_slice);
+  printf("Eviction test threshold: %lu cycles\n", miss_threshold);
+  printf("Building %d sets in each of %d thread%s...\n", sets, threads,
+         threads == 1 ? "" : "s");
+
+  worker_t *workers = calloc(threads, sizeof(*workers));
+  pthread_t *tids = calloc(threads, sizeof(*tids));
+  if (!workers || !tids)
+    return 1;
+
+  double wall_start = monotonic_seconds();
+  for (int t = 0; t < threads; t++) {
+    worker_t *w = &workers[t];
+    w->id = t;
+    w->sets = sets;
+    w->pool_bytes = pool_bytes;
+    w->hugepages = hugepages;
+    w->sets_per_slice = sets_per_slice;
+    w->llc = &llc;
+    w->miss_threshold = miss_threshold;
+    w->build_cycles = calloc(sets, sizeof(*w->build_cycles));
+    if (!w->build_cycles) {
+      fprintf(stderr, "Failed to start thread %d\n", t);
+      return 1;
+    }
+    // Pinned from creation, so the pool is faulted in on the worker's own
+    // core and its first timings are not taken before a migration
+    pthread_attr_t attr;
+    cpu_set_t set;
+    pthread_attr_init(&attr);
+    CPU_ZERO(&set);
+    CPU_SET(t % cpus, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    int err = pthread_create(&tids[t], &attr, worker_main, w);
+    pthread_attr_destroy(&attr);
+    if (err == EINVAL) {
+      fprintf(stderr, "Warning: could not pin thread %d to core %ld\n", t,
+              t % cpus);
+      err = pthread_create(&tids[t], NULL, worker_main, w);
+    }
+    if (err != 0) {
+      fprintf(stderr, "Failed to start thread %d\n", t);
+      return 1;
+    }
+  }
+  for (int t = 0; t < threads; t++)
+    pthread_join(tids[t], NULL);
+  double wall = monotonic_seconds() - wall_start;
+
+  // Merge per-thread results
+  uint64_t *all = calloc((size_t)sets * threads, sizeof(*all));
+  int built = 0, verified = 0, errors = 0;
+  uint64_t tests = 0;
+  size_t memory = 0;
+  for (int t = 0; t < threads; t++) {
+    worker_t *w = &workers[t];
+    errors += w->error;
+    memcpy(all + built, w->build_cycles, w->built * sizeof(*all));
+    built += w->built;
+    verified += w->verified;
+    tests += w->tests;
+    memory += w->pool.bytes + w->targets.bytes;
+  }
+  int attempted = sets * (threads - errors);
+
+  printf("\n=== EVICTION SET RESULTS ===\n");
+  printf("Pool: %zu MB per thread, %s, stride %zu bytes (%zu candidates "
+         "per target)\n",
+         workers[0].pool.bytes >> 20, pool_backing(&workers[0].pool),
+         workers[0].pool.stride, workers[0].pool.strides);
+  printf("Memory: %zu MB in %d thread%s\n", memory >> 20, threads,
+         threads == 1 ? "" : "s");
+  printf("Built: %d of %d (%.1f%%), verified %d (%.1f%%)\n", built, attempted,
+         attempted ? 100.0 * built / attempted : 0.0, verified,
+         attempted ? 100.0 * verified / attempted : 0.0);
+  printf("Eviction tests: %.0f per set\n",
+         attempted ? (double)tests / attempted : 0.0);
+  if (built) {
+    uint64_t sum = 0;
+    for (int i = 0; i < built; i++)
+      sum += all[i];
+    qsort(all, built, sizeof(*all), compare_u64);
+    printf("Build time per set: mean %.2f ms, median %.2f ms, max %.2f ms\n",
+           sum * 1e3 / built / tsc_hz, all[built / 2] * 1e3 / tsc_hz,
+           all[built - 1] * 1e3 / tsc_hz);
+  }
+  printf("Wall time: %.3f s, %.1f sets/s across %ld CPUs\n", wall,
+         built / wall, cpus);
+
+  for (int t = 0; t < threads; t++) {
+    evset_pool_free(&workers[t].pool);
+    evset_pool_free(&workers[t].targets);
+    free(workers[t].build_cycles);
+  }
+  free(all);
+  free(tids);
+  free(workers);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+#include "harness.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TSC_CALIBRATION_NS 100000000ULL
+
+static void status_path(const char *name, char *path, size_t len) {
+  snprintf(path, len, "%s/fr-%s.status", HARNESS_STATUS_DIR, name);
+}
+
+harness_status_t *harness_status_create(const char *name) {
+  char path[256];
+  status_path(name, path, sizeof(path));
+
+  // Start from a fresh inode so readers of a previous run keep their old
+  // page instead of seeing it truncated under them
+  unlink(path);
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    perror(path);
+    return NULL;
+  }
+  if (ftruncate(fd, HARNESS_STATUS_SIZE) < 0) {
+    perror("ftruncate");
+    close(fd);
+    return NULL;
+  }
+
+  harness_status_t *st = mmap(NULL, HARNESS_STATUS_SIZE,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (st == MAP_FAILED) {
+    perror("mmap");
+    return NULL;
+  }
+
+  memset(st, 0, HARNESS_STATUS_SIZE);
+  st->pid = getpid();
+  st->magic = HARNESS_STATUS_MAGIC;
+  return st;
+}
+
+static harness_status_t *status_open(const char *name, int quiet) {
+  char path[256];
+  status_path(name, path, sizeof(path));
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    if (!quiet)
+      perror(path);
+    return NULL;
+  }
+
+  harness_status_t *st =
+      mmap(NULL, HARNESS_STATUS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (st == MAP_FAILED) {
+    perror("mmap");
+    return NULL;
+  }
+
+  if (st->magic != HARNESS_STATUS_MAGIC) {
+    if (!quiet)
+      fprintf(stderr, "%s: not a victim status page\n", path);
+    munmap(st, HARNESS_STATUS_SIZE);
+    return NULL;
+  }
+  return st;
+}
+
+harness_status_t *harness_status_open(const char *name) {
+  return status_open(name, 0);
+}
+
+harness_status_t *harness_status_find(const char *name) {
+  return status_open(name, 1);
+}
+
+harness_status_t *harness_status_wait(const char *name, int timeout_ms) {
+  for (int waited = 0; waited <= timeout_ms; waited += 10) {
+    harness_status_t *st = status_open(name, 1);
+    if (st && st->ready && !st->finished)
+      return st;
+    // Finished without ever being ready: the owner failed during setup
+    if (st && st->finished && !st->ready) {
+      harness_status_close(st);
+      fprintf(stderr, "Status page '%s' was abandoned during setup\n", name);
+      return NULL;
+    }
+    harness_status_close(st);
+    usleep(10000);
+  }
+  fprintf(stderr, "Timed out waiting for status page '%s'\n", name);
+  return NULL;
+}
+
+void harness_status_close(harness_status_t *st) {
+  if (st)
+    munmap(st, HARNESS_STATUS_SIZE);
+}
+
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t harness_tsc_hz(void) {
+  uint64_t ns_start = monotonic_ns();
+  uint64_t tsc_start = harness_rdtsc();
+  uint64_t ns_now;
+
+  do {
+    ns_now = monotonic_ns();
+  } while (ns_now - ns_start < TSC_CALIBRATION_NS);
+
+  uint64_t cycles = harness_rdtsc() - tsc_start;
+  return cycles * 1000000000ULL / (ns_now - ns_start);
+}
+
+int harness_resolve_mapping(const void *addr, char *path, size_t len,
+                            uint64_t *offset) {
+  FILE *maps = fopen("/proc/self/maps", "r");
+  if (!maps)
+    return -1;
+
+  char line[1024];
+  int found = -1;
+  uintptr_t target = (uintptr_t)addr;
+
+  while (fgets(line, sizeof(line), maps)) {
+    unsigned long start, end, file_offset;
+    char file[HARNESS_PATH_MAX];
+    if (sscanf(line, "%lx-%lx %*s %lx %*s %*s %255s", &start, &end,
+               &file_offset, file) != 4)
+      continue;
+    if (target >= start && target < end) {
+      snprintf(path, len, "%s", file);
+      *offset = target - start + file_offset;
+      found = 0;
+      break;
+    }
+  }
+  fclose(maps);
+  return found;
+}
+
+void *harness_library_base(const char *name) {
+  FILE *maps = fopen("/proc/self/maps", "r");
+  if (!maps)
+    return NULL;
+
+  char line[1024];
+  void *base_addr = NULL;
+
+  while (fgets(line, sizeof(line), maps)) {
+    if (strstr(line, name)) {
+      unsigned long addr;
+      if (sscanf(line, "%lx-", &addr) == 1) {
+        base_addr = (void *)addr;
+        break;
+      }
+    }
+  }
+  fclose(maps);
+  return base_addr;
+}
@@ -0,0 +1,111 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared status page published by the lab victims.
+//
+// A victim creates the page under HARNESS_STATUS_DIR and updates it around
+// every secret-dependent operation. Measurement tools map it read-only to
+// segment their captures and to score them against ground truth. The page is
+// a lab convenience only: a real attacker has no such channel.
+
+#define HARNESS_STATUS_DIR "/tmp"
+#define HARNESS_STATUS_MAGIC 0x54535246 // "FRST"
+#define HARNESS_STATUS_SIZE 4096
+
+#define HARNESS_PATH_MAX 256
+#define HARNESS_PROFILE_LEN 128
+
+// TVLA input classes
+#define HARNESS_CLASS_FIXED 0
+#define HARNESS_CLASS_RANDOM 1
+
+typedef struct {
+  uint32_t magic;
+  int32_t pid;
+  volatile uint32_t ready;    // set once the victim enters its main loop
+  volatile uint32_t finished; // set when a finite run is complete
+  volatile uint32_t op_class; // class of the operation in flight: TVLA class,
+                              // or victim_aes' first plaintext byte
+  volatile uint64_t op_seq;   // odd while an operation is in flight
+
+  // Synthetic victim and covert sender ground truth: bit k of the stream
+  // generated from bit_seed is sent at bit_t0 + k * bit_period.
+  char target_path[HARNESS_PATH_MAX]; // file backing the target lines
+  uint64_t target_offset[2];          // file offsets of the two lines
+  uint64_t tsc_hz;
+  uint64_t bit_seed;
+  uint64_t bit_t0;
+  uint64_t bit_period;
+  uint64_t bit_count; // bits in the current run, 0 if unbounded
+  volatile uint64_t late_bits; // bits executed after their deadline
+
+  // Load generator: description of the active load profile
+  char profile[HARNESS_PROFILE_LEN];
+
+  // AES victim: cipher configuration and encryption throughput in bytes/s,
+  // measured over the encryption calls only
+  char cipher_desc[64];
+  volatile uint64_t throughput;
+} harness_status_t;
+
+harness_status_t *harness_status_create(const char *name);
+harness_status_t *harness_status_open(const char *name);
+// Like harness_status_open, but silent when no such page exists.
+harness_status_t *harness_status_find(const char *name);
+void harness_status_close(harness_status_t *st);
+
+// Poll until a victim publishes a ready, unfinished page under name, or
+// timeout_ms elapses (returns NULL). A page finished before it was ever
+// ready belongs to a victim that failed during setup and also returns NULL.
+harness_status_t *harness_status_wait(const char *name, int timeout_ms);
+
+// Measure the TSC frequency against CLOCK_MONOTONIC.
+uint64_t harness_tsc_hz(void);
+
+// Find the file and file offset backing a mapped code address, so another
+// process can map the same page cache page.
+int harness_resolve_mapping(const void *addr, char *path, size_t len,
+                            uint64_t *offset);
+
+// Start of the first mapping of this process whose line in /proc/self/maps
+// contains name (e.g. "libgcrypt.so"), or NULL. Symbol offsets taken from
+// the library file are relative to it.
+void *harness_library_base(const char *name);
+
+static inline uint64_t harness_rdtsc(void) {
+  unsigned int lo, hi;
+  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+// Ground-truth bit stream shared by the synthetic victim and its scorers.
+// xorshift64: the seed must be nonzero.
+static inline int harness_next_bit(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x & 1;
+}
+
+// Mark the start of an operation of the given class. The class is written
+// before the sequence number so a reader seeing an odd op_seq also sees the
+// matching op_class.
+static inline void harness_op_begin(harness_status_t *st, uint32_t op_class) {
+  st->op_class = op_class;
+  __atomic_store_n(&st->op_seq, st->op_seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline void harness_op_end(harness_status_t *st) {
+  __atomic_store_n(&st->op_seq, st->op_seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t harness_op_seq(const harness_status_t *st) {
+  return __atomic_load_n(&st->op_seq, __ATOMIC_ACQUIRE);
+}
+
+#endif
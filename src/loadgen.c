@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "harness.h"
+
+// Co-located load generator for robustness measurements.
+//
+// Runs one pinned worker thread per requested core with one of three
+// workloads: streaming memory bandwidth, LLC thrashing or a syscall storm.
+// The active profile is published on the "load" status page, where
+// attacker_rsa picks it up and records it in the trace header.
+
+#define CACHE_LINE_SIZE 64
+#define MAX_WORKERS 64
+#define MEMBW_BUFFER_SIZE (256UL << 20)
+#define LLC_FALLBACK_SIZE (32UL << 20)
+#define LLC_STRIDE_LINES 4099 // prime stride defeats the prefetchers
+#define LOAD_STATUS_NAME "load"
+
+typedef enum { LOAD_MEMBW, LOAD_LLC, LOAD_SYSCALL } load_kind_t;
+
+static const char *load_names[] = {"membw", "llc", "syscall"};
+static const char *load_units[] = {"GB/s", "Mlines/s", "Msyscalls/s"};
+
+typedef struct {
+  load_kind_t kind;
+  int cpu;
+  pthread_t thread;
+  char *buffer;
+  size_t size;
+  uint64_t work; // bytes, lines or syscalls completed
+} worker_t;
+
+volatile int running = 1;
+static int workers_ready; // workers that have touched their buffer
+
+void signal_handler(int sig) { running = 0; }
+
+// Size of the last level cache of cpu0, from sysfs
+size_t llc_size(void) {
+  FILE *f = fopen("/sys/devices/system/cpu/cpu0/cache/index3/size", "r");
+  if (!f)
+    return LLC_FALLBACK_SIZE;
+
+  unsigned long kb = 0;
+  if (fscanf(f, "%luK", &kb) != 1)
+    kb = 0;
+  fclose(f);
+  return kb ? kb << 10 : LLC_FALLBACK_SIZE;
+}
+
+// Stream through a buffer well beyond the LLC, reading and writing every line
+void run_membw(worker_t *w) {
+  uint64_t *buf = (uint64_t *)w->buffer;
+  size_t words = w->size / sizeof(uint64_t);
+
+  while (running) {
+    for (size_t i = 0; i < words; i += CACHE_LINE_SIZE / sizeof(uint64_t))
+      buf[i]++;
+    w->work += w->size;
+  }
+}
+
+// Touch a buffer twice the LLC size in a scattered order, evicting other
+// tenants' lines from every set
+void run_llc(worker_t *w) {
+  size_t lines = w->size / CACHE_LINE_SIZE;
+  size_t idx = 0;
+
+  while (running) {
+    for (size_t i = 0; i < lines; i++) {
+      w->buffer[idx * CACHE_LINE_SIZE]++;
+      idx = (idx + LLC_STRIDE_LINES) % lines;
+    }
+    w->work += lines;
+  }
+}
+
+// Enter and leave the kernel as fast as possible; getppid is never cached
+void run_syscall(worker_t *w) {
+  while (running) {
+    for (int i = 0; i < 1000; i++)
+      syscall(SYS_getppid);
+    w->work += 1000;
+  }
+}
+
+void *worker_main(void *arg) {
+  worker_t *w = arg;
+
+  // First touch from the worker's own core, so the pages are local to it
+  if (w->buffer)
+    memset(w->buffer, 1, w->size);
+  __atomic_add_fetch(&workers_ready, 1, __ATOMIC_RELEASE);
+
+  switch (w->kind) {
+  case LOAD_MEMBW:
+    run_membw(w);
+    break;
+  case LOAD_LLC:
+    run_llc(w);
+    break;
+  case LOAD_SYSCALL:
+    run_syscall(w);
+    break;
+  }
+  return NULL;
+}
+
+// Parse "1,2,5" into workers of the given kind
+int add_workers(worker_t *workers, int n, load_kind_t kind, char *cpus) {
+  for (char *tok = strtok(cpus, ","); tok; tok = strtok(NULL, ",")) {
+    if (n == MAX_WORKERS) {
+      fprintf(stderr, "Too many workers (max %d)\n", MAX_WORKERS);
+      return -1;
+    }
+    workers[n].kind = kind;
+    workers[n].cpu = atoi(tok);
+    n++;
+  }
+  return n;
+}
+
+// Build the profile string recorded in trace headers, e.g.
+// "membw@2,3 llc@4"
+void describe_profile(worker_t *workers, int n, char *out, size_t len) {
+  size_t pos = 0;
+  out[0] = '\0';
+
+  for (int kind = LOAD_MEMBW; kind <= LOAD_SYSCALL; kind++) {
+    int first = 1;
+    for (int i = 0; i < n; i++) {
+      if (workers[i].kind != (load_kind_t)kind)
+        continue;
+      if (first)
+        pos += snprintf(out + pos, len - pos, "%s%s@%d", pos ? " " : "",
+                        load_names[kind], workers[i].cpu);
+      else
+        pos += snprintf(out + pos, len - pos, ",%d", workers[i].cpu);
+      if (pos >= len)
+        return; // truncated
+      first = 0;
+    }
+  }
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--membw CPUS] [--llc CPUS] [--syscall CPUS] "
+          "[--duration SEC]\n",
+          prog);
+  fprintf(stderr, "  --membw CPUS    stream memory bandwidth on the listed cores\n");
+  fprintf(stderr, "  --llc CPUS      thrash the last level cache\n");
+  fprintf(stderr, "  --syscall CPUS  run a syscall storm\n");
+  fprintf(stderr, "  --duration SEC  stop after SEC seconds (default: until Ctrl+C)\n");
+  fprintf(stderr, "CPUS is a comma separated list, e.g. --membw 2,3\n");
+}
+
+int main(int argc, char *argv[]) {
+  worker_t workers[MAX_WORKERS];
+  int num_workers = 0;
+  int duration = 0;
+
+  memset(workers, 0, sizeof(workers));
+
+  static const struct option long_options[] = {
+      {"membw", required_argument, NULL, 'm'},
+      {"llc", required_argument, NULL, 'l'},
+      {"syscall", required_argument, NULL, 'y'},
+      {"duration", required_argument, NULL, 'd'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "m:l:y:d:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'm':
+      num_workers = add_workers(workers, num_workers, LOAD_MEMBW, optarg);
+      break;
+    case 'l':
+      num_workers = add_workers(workers, num_workers, LOAD_LLC, optarg);
+      break;
+    case 'y':
+      num_workers = add_workers(workers, num_workers, LOAD_SYSCALL, optarg);
+      break;
+    case 'd':
+      duration = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+    if (num_workers < 0)
+      return 1;
+  }
+  if (num_workers == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  printf("Load generator starting (PID: %d)\n", getpid());
+
+  signal(SIGTERM, signal_handler);
+  signal(SIGINT, signal_handler);
+
+  harness_status_t *status = harness_status_create(LOAD_STATUS_NAME);
+  if (!status)
+    return 1;
+  describe_profile(workers, num_workers, status->profile,
+                   sizeof(status->profile));
+
+  size_t llc_buffer = 2 * llc_size();
+  int started = 0, failed = 0;
+  for (int i = 0; i < num_workers && !failed; i++) {
+    worker_t *w = &workers[i];
+
+    if (w->kind == LOAD_MEMBW)
+      w->size = MEMBW_BUFFER_SIZE;
+    else if (w->kind == LOAD_LLC)
+      w->size = llc_buffer;
+    if (w->size) {
+      w->buffer = aligned_alloc(4096, w->size);
+      if (!w->buffer) {
+        fprintf(stderr, "Failed to allocate %zu bytes\n", w->size);
+        failed = 1;
+        break;
+      }
+    }
+
+    // Pinned from the start, so the worker's first touches happen on its
+    // own core
+    pthread_attr_t attr;
+    cpu_set_t set;
+    pthread_attr_init(&attr);
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    int err = pthread_create(&w->thread, &attr, worker_main, w);
+    pthread_attr_destroy(&attr);
+    if (err == EINVAL) {
+      fprintf(stderr, "Warning: could not pin %s worker to core %d\n",
+              load_names[w->kind], w->cpu);
+      err = pthread_create(&w->thread, NULL, worker_main, w);
+    }
+    if (err != 0) {
+      fprintf(stderr, "Failed to start worker %d\n", i);
+      failed = 1;
+      break;
+    }
+    started++;
+  }
+
+  if (failed) {
+    running = 0;
+    status->finished = 1;
+    for (int i = 0; i < started; i++)
+      pthread_join(workers[i].thread, NULL);
+    for (int i = 0; i < num_workers; i++)
+      free(workers[i].buffer);
+    harness_status_close(status);
+    return 1;
+  }
+
+  // Publish the profile once every worker is loading
+  while (running &&
+         __atomic_load_n(&workers_ready, __ATOMIC_ACQUIRE) < num_workers)
+    usleep(1000);
+  status->ready = 1;
+  printf("Load profile: %s\n", status->profile);
+  printf("Press Ctrl+C to stop\n");
+
+  uint64_t start = harness_rdtsc();
+  for (int elapsed = 0; running && (!duration || elapsed < duration);
+       elapsed++)
+    sleep(1);
+  running = 0;
+  uint64_t cycles = harness_rdtsc() - start;
+  double seconds = (double)cycles / harness_tsc_hz();
+
+  status->finished = 1;
+  printf("\n=== LOAD SUMMARY (%.1f s) ===\n", seconds);
+  for (int i = 0; i < num_workers; i++) {
+    worker_t *w = &workers[i];
+    pthread_join(w->thread, NULL);
+
+    double rate = w->work / seconds;
+    rate /= w->kind == LOAD_MEMBW ? 1e9 : 1e6;
+    printf("  %-8s core %3d: %10.2f %s\n", load_names[w->kind], w->cpu, rate,
+           load_units[w->kind]);
+    free(w->buffer);
+  }
+
+  harness_status_close(status);
+  return 0;
+}
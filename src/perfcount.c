@@ -0,0 +1,47 @@
+#define _GNU_SOURCE
+#include "perfcount.h"
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int perf_llc_open(void) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.inherit = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void perf_enable(int fd) {
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void perf_disable(int fd) {
+  if (fd >= 0)
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t perf_read(int fd) {
+  uint64_t count;
+
+  if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+    return 0;
+  return count;
+}
+
+void perf_close(int fd) {
+  if (fd >= 0)
+    close(fd);
+}
@@ -0,0 +1,22 @@
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <stdint.h>
+
+// Hardware event counting for the calling thread through perf_event_open.
+//
+// Used to measure an engine's cache-miss footprint, the signal a counter-based
+// detector watches. Hosts without a PMU (most VMs) or with a restrictive
+// perf_event_paranoid make perf_llc_open fail; callers report "unavailable".
+
+// Count LLC misses (PERF_COUNT_HW_CACHE_MISSES) of the calling thread, and of
+// threads it starts afterwards once they have exited, in user space, starting
+// disabled. Returns a descriptor or -1.
+int perf_llc_open(void);
+void perf_enable(int fd);
+void perf_disable(int fd);
+// Current count, or 0 on error
+uint64_t perf_read(int fd);
+void perf_close(int fd);
+
+#endif
@@ -0,0 +1,145 @@
+#define _GNU_SOURCE
+#include "probe.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CALIBRATION_CYCLES 20000000ULL // TSC cycles spent comparing clocks
+#define CALIBRATION_READS 100000
+#define CALIBRATION_PROBES 1000
+
+probe_counter_t probe_counter;
+
+static pthread_t counter_thread;
+
+static const char *timer_names[PROBE_NUM_TIMERS] = {"rdtsc", "rdtscp",
+                                                    "counter"};
+
+const char *probe_timer_name(probe_timer_t timer) {
+  return timer < PROBE_NUM_TIMERS ? timer_names[timer] : "unknown";
+}
+
+int probe_timer_parse(const char *name, probe_timer_t *timer) {
+  for (int i = 0; i < PROBE_NUM_TIMERS; i++) {
+    if (strcmp(name, timer_names[i]) == 0) {
+      *timer = i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+// The counting loop: a plain increment through a volatile, so every value is
+// stored and readers on other cores see it advance one step at a time
+static void *counter_main(void *arg) {
+  while (probe_counter.running)
+    probe_counter.value++;
+  return NULL;
+}
+
+int probe_timer_start(probe_timer_t timer, int cpu) {
+  if (timer != PROBE_TIMER_COUNTER)
+    return 0;
+
+  probe_counter.value = 0;
+  probe_counter.running = 1;
+  probe_counter.cpu = cpu;
+  if (pthread_create(&counter_thread, NULL, counter_main, NULL) != 0) {
+    fprintf(stderr, "Failed to start the counter thread\n");
+    probe_counter.running = 0;
+    return -1;
+  }
+
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(counter_thread, sizeof(set), &set) != 0)
+      fprintf(stderr, "Warning: cannot pin the counter thread to core %d\n",
+              cpu);
+  }
+
+  while (probe_counter.value == 0)
+    sched_yield();
+  return 0;
+}
+
+void probe_timer_stop(probe_timer_t timer) {
+  if (timer != PROBE_TIMER_COUNTER || !probe_counter.running)
+    return;
+  probe_counter.running = 0;
+  pthread_join(counter_thread, NULL);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint64_t median_reload(probe_timer_t timer, const char *line,
+                              int flushed) {
+  uint64_t samples[CALIBRATION_PROBES];
+
+  for (int i = 0; i < CALIBRATION_PROBES; i++) {
+    if (flushed)
+      probe_flush(line);
+    else
+      (void)*(const volatile char *)line;
+    samples[i] = probe_load_time(timer, line);
+  }
+  qsort(samples, CALIBRATION_PROBES, sizeof(*samples), compare_u64);
+  return samples[CALIBRATION_PROBES / 2];
+}
+
+static uint64_t median_flush(probe_timer_t timer, const char *line,
+                             int cached) {
+  uint64_t samples[CALIBRATION_PROBES];
+
+  for (int i = 0; i < CALIBRATION_PROBES; i++) {
+    if (cached)
+      (void)*(const volatile char *)line;
+    samples[i] = probe_flush_time(timer, line);
+  }
+  qsort(samples, CALIBRATION_PROBES, sizeof(*samples), compare_u64);
+  return samples[CALIBRATION_PROBES / 2];
+}
+
+void probe_flush_calibrate(probe_timer_t timer, const void *addr,
+                           uint64_t *cached, uint64_t *uncached) {
+  *cached = median_flush(timer, addr, 1);
+  *uncached = median_flush(timer, addr, 0);
+}
+
+void probe_timer_calibrate(probe_timer_t timer, probe_calibration_t *cal) {
+  static char line[64] __attribute__((aligned(64)));
+
+  // Rate against the TSC over a fixed number of cycles
+  uint64_t t0 = probe_rdtsc();
+  uint64_t c0 = probe_begin(timer);
+  uint64_t t1;
+  do {
+    t1 = probe_rdtsc();
+  } while (t1 - t0 < CALIBRATION_CYCLES);
+  uint64_t c1 = probe_end(timer);
+  cal->ticks_per_cycle = (double)(c1 - c0) / (t1 - t0);
+
+  // Distinct values seen by back-to-back reads
+  uint64_t steps = 0;
+  uint64_t last = probe_begin(timer);
+  t0 = probe_rdtsc();
+  for (int i = 0; i < CALIBRATION_READS; i++) {
+    uint64_t now = probe_begin(timer);
+    steps += now != last;
+    last = now;
+  }
+  t1 = probe_rdtsc();
+  cal->cycles_per_step = steps ? (double)(t1 - t0) / steps : 0;
+
+  cal->hit_median = median_reload(timer, line, 0);
+  cal->miss_median = median_reload(timer, line, 1);
+  probe_flush_calibrate(timer, line, &cal->flush_hit_median,
+                        &cal->flush_miss_median);
+}
@@ -0,0 +1,160 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdint.h>
+
+// Probe engine shared by the attackers.
+//
+// One Flush+Reload step is: start the timer, load the line, stop the timer,
+// flush the line. The timer is selectable because its fencing and resolution
+// decide the hit threshold: latencies are in the timer's own units, so a
+// threshold tuned for one timer does not carry over to another.
+
+typedef enum {
+  PROBE_TIMER_RDTSC,   // lfence-serialised rdtsc
+  PROBE_TIMER_RDTSCP,  // rdtscp, lfence after the read
+  PROBE_TIMER_COUNTER, // shared counter bumped by a dedicated thread
+} probe_timer_t;
+
+#define PROBE_NUM_TIMERS 3
+
+// Reload latency, in rdtsc cycles, below which a line counts as cached. The
+// one default for every Flush+Reload tool; a tool that calibrates (see
+// probe_timer_calibrate) may replace it with this host's hit/miss midpoint.
+#define PROBE_RELOAD_THRESHOLD 165
+
+// Counter timer state. The counter sits alone on its cache line so the
+// incrementing thread does not contend with anything but the readers.
+typedef struct {
+  volatile uint64_t value __attribute__((aligned(64)));
+  volatile int running __attribute__((aligned(64)));
+  int cpu;
+} probe_counter_t;
+
+extern probe_counter_t probe_counter;
+
+// How a timer relates to the TSC on this host
+typedef struct {
+  double ticks_per_cycle;  // timer units per TSC cycle
+  double cycles_per_step;  // TSC cycles between distinct back-to-back reads
+  uint64_t hit_median;     // reload latency of a cached line, timer units
+  uint64_t miss_median;    // reload latency of a flushed line, timer units
+  uint64_t flush_hit_median;  // clflush time of a cached line
+  uint64_t flush_miss_median; // clflush time of a line not in the cache
+} probe_calibration_t;
+
+const char *probe_timer_name(probe_timer_t timer);
+// Parse "rdtsc", "rdtscp" or "counter"; returns -1 for anything else.
+int probe_timer_parse(const char *name, probe_timer_t *timer);
+
+// Prepare a timer for use. For the counter timer this starts the counting
+// thread, pinned to cpu unless cpu is negative, and waits until it runs.
+int probe_timer_start(probe_timer_t timer, int cpu);
+void probe_timer_stop(probe_timer_t timer);
+
+// Measure a started timer against the TSC and time cached and flushed reloads
+// and flushes of a private line. cycles_per_step is the effective resolution: for rdtsc it
+// is the cost of a read, for the counter how often readers see it move.
+void probe_timer_calibrate(probe_timer_t timer, probe_calibration_t *cal);
+
+// Median Flush+Flush times of addr when cached and when not, for a threshold
+// on the line actually monitored.
+void probe_flush_calibrate(probe_timer_t timer, const void *addr,
+                           uint64_t *cached, uint64_t *uncached);
+
+// Unfenced TSC read, for slot clocks and deadlines rather than latencies.
+static inline uint64_t probe_rdtsc(void) {
+  unsigned int lo, hi;
+  asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void probe_flush(const void *addr) {
+  asm volatile("clflush (%0)" : : "r"(addr) : "memory");
+}
+
+// Open a timed region: nothing before it is still in flight and nothing
+// after it has started.
+static inline uint64_t probe_begin(probe_timer_t timer) {
+  unsigned int lo, hi;
+  uint64_t t;
+
+  switch (timer) {
+  case PROBE_TIMER_RDTSCP:
+    asm volatile("mfence\n"
+                 "rdtscp\n"
+                 "lfence\n"
+                 : "=a"(lo), "=d"(hi)
+                 :
+                 : "%rcx", "memory");
+    return ((uint64_t)hi << 32) | lo;
+  case PROBE_TIMER_COUNTER:
+    asm volatile("mfence\nlfence" : : : "memory");
+    t = probe_counter.value;
+    asm volatile("lfence" : : : "memory");
+    return t;
+  default:
+    asm volatile("mfence\n"
+                 "lfence\n"
+                 "rdtsc\n"
+                 "lfence\n"
+                 : "=a"(lo), "=d"(hi)
+                 :
+                 : "memory");
+    return ((uint64_t)hi << 32) | lo;
+  }
+}
+
+// Close a timed region once everything inside it has completed.
+static inline uint64_t probe_end(probe_timer_t timer) {
+  unsigned int lo, hi;
+  uint64_t t;
+
+  switch (timer) {
+  case PROBE_TIMER_RDTSCP:
+    asm volatile("rdtscp\n"
+                 "lfence\n"
+                 : "=a"(lo), "=d"(hi)
+                 :
+                 : "%rcx", "memory");
+    return ((uint64_t)hi << 32) | lo;
+  case PROBE_TIMER_COUNTER:
+    asm volatile("lfence" : : : "memory");
+    t = probe_counter.value;
+    return t;
+  default:
+    asm volatile("lfence\n"
+                 "rdtsc\n"
+                 : "=a"(lo), "=d"(hi)
+                 :
+                 : "memory");
+    return ((uint64_t)hi << 32) | lo;
+  }
+}
+
+// Latency of one load of addr, in timer units.
+static inline uint64_t probe_load_time(probe_timer_t timer, const void *addr) {
+  uint64_t start = probe_begin(timer);
+  (void)*(const volatile char *)addr;
+  return probe_end(timer) - start;
+}
+
+// One Flush+Reload step: time the reload, then flush for the next one.
+static inline uint64_t probe_reload(probe_timer_t timer, const void *addr) {
+  uint64_t time = probe_load_time(timer, addr);
+  probe_flush(addr);
+  return time;
+}
+
+// One Flush+Flush step: time the flush itself. Flushing a line that some
+// cache holds takes longer than flushing one nobody holds, and the line is
+// flushed either way, so the probe never loads anything.
+static inline uint64_t probe_flush_time(probe_timer_t timer, const void *addr) {
+  uint64_t start = probe_begin(timer);
+  probe_flush(addr);
+  // lfence does not order clflush; wait for it to complete
+  asm volatile("mfence" : : : "memory");
+  return probe_end(timer) - start;
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "probe.h"
+
+// Microbenchmark of the probe engine's timers on the current host.
+//
+// For every timer it measures an empty timed region (the measurement
+// overhead), a reload of a cached line and a reload of a flushed line, and
+// prints mean, spread and percentiles in the timer's own units. The gap
+// between the hit and miss distributions is what a Flush+Reload threshold
+// has to fall into. The flush rows time clflush of a cached and of an
+// uncached line, the two cases a Flush+Flush threshold separates.
+
+#define DEFAULT_SAMPLES 100000
+
+typedef struct {
+  double mean;
+  double stddev;
+  uint64_t min;
+  uint64_t median;
+  uint64_t p99;
+} sample_stats_t;
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+void summarize(uint64_t *samples, int n, sample_stats_t *st) {
+  double sum = 0, sq = 0;
+
+  for (int i = 0; i < n; i++)
+    sum += samples[i];
+  st->mean = sum / n;
+  for (int i = 0; i < n; i++)
+    sq += (samples[i] - st->mean) * (samples[i] - st->mean);
+  st->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+
+  qsort(samples, n, sizeof(*samples), compare_u64);
+  st->min = samples[0];
+  st->median = samples[n / 2];
+  st->p99 = samples[(int)(n * 0.99)];
+}
+
+void print_row(const char *what, const sample_stats_t *st) {
+  printf("  %-10s %10.1f %10.1f %8lu %8lu %8lu\n", what, st->mean, st->stddev,
+         st->min, st->median, st->p99);
+}
+
+void bench_timer(probe_timer_t timer, uint64_t *samples, int n) {
+  static char line[4096] __attribute__((aligned(4096)));
+  sample_stats_t overhead, hit, miss, fhit, fmiss;
+
+  for (int i = 0; i < n; i++) {
+    uint64_t start = probe_begin(timer);
+    samples[i] = probe_end(timer) - start;
+  }
+  summarize(samples, n, &overhead);
+
+  line[0] = 1;
+  for (int i = 0; i < n; i++)
+    samples[i] = probe_load_time(timer, line);
+  summarize(samples, n, &hit);
+
+  probe_flush(line);
+  for (int i = 0; i < n; i++)
+    samples[i] = probe_reload(timer, line);
+  summarize(samples, n, &miss);
+
+  // Flush+Flush: flush a cached line, then flush a line already flushed
+  for (int i = 0; i < n; i++) {
+    (void)*(volatile char *)line;
+    samples[i] = probe_flush_time(timer, line);
+  }
+  summarize(samples, n, &fhit);
+  for (int i = 0; i < n; i++)
+    samples[i] = probe_flush_time(timer, line);
+  summarize(samples, n, &fmiss);
+
+  printf("\n%s:\n", probe_timer_name(timer));
+  printf("  %-10s %10s %10s %8s %8s %8s\n", "", "mean", "stddev", "min",
+         "median", "p99");
+  print_row("overhead", &overhead);
+  print_row("hit", &hit);
+  print_row("miss", &miss);
+  print_row("flush hit", &fhit);
+  print_row("flush miss", &fmiss);
+  if (miss.median > hit.p99)
+    printf("  threshold window: %lu..%lu\n", hit.p99, miss.median);
+  else
+    printf("  hit and miss overlap: no usable threshold\n");
+  // Which flush is slower depends on the microarchitecture
+  if (fhit.median != fmiss.median)
+    printf("  flush threshold: %lu, cached lines flush %s by %lu\n",
+           (fhit.median + fmiss.median) / 2,
+           fhit.median > fmiss.median ? "slower" : "faster",
+           fhit.median > fmiss.median ? fhit.median - fmiss.median
+                                      : fmiss.median - fhit.median);
+  else
+    printf("  flush hit and miss overlap: no usable flush threshold\n");
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s [--timer NAME] [--samples N] [--counter-cpu N]\n",
+          prog);
+  fprintf(stderr, "  --timer NAME      rdtsc, rdtscp or counter (default: all)\n");
+  fprintf(stderr, "  --samples N       samples per measurement (default: %d)\n",
+          DEFAULT_SAMPLES);
+  fprintf(stderr, "  --counter-cpu N   pin the counter thread to core N\n");
+}
+
+int main(int argc, char *argv[]) {
+  int n = DEFAULT_SAMPLES;
+  int counter_cpu = -1;
+  int only = -1;
+
+  static const struct option long_options[] = {
+      {"timer", required_argument, NULL, 't'},
+      {"samples", required_argument, NULL, 'n'},
+      {"counter-cpu", required_argument, NULL, 'c'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "t:n:c:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 't': {
+      probe_timer_t timer;
+      if (probe_timer_parse(optarg, &timer) < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      only = timer;
+      break;
+    }
+    case 'n':
+      n = atoi(optarg);
+      break;
+    case 'c':
+      counter_cpu = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (n < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  uint64_t *samples = malloc(n * sizeof(*samples));
+  if (!samples)
+    return 1;
+
+  printf("=== PROBE TIMER RESULTS (%d samples, units per timer) ===\n", n);
+  for (int t = 0; t < PROBE_NUM_TIMERS; t++) {
+    if (only >= 0 && t != only)
+      continue;
+    if (probe_timer_start(t, counter_cpu) < 0)
+      continue;
+    bench_timer(t, samples, n);
+    probe_timer_stop(t);
+  }
+
+  free(samples);
+  return 0;
+}
@@ -0,0 +1,75 @@
+#define _GNU_SOURCE
+#include "realtime.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int rt_enable_fifo(void) {
+  struct sched_param param;
+
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+  if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+    return -1;
+  return param.sched_priority;
+}
+
+int rt_pinned_cpu(void) {
+  cpu_set_t set;
+
+  if (sched_getaffinity(0, sizeof(set), &set) < 0 || CPU_COUNT(&set) != 1)
+    return -1;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET(cpu, &set))
+      return cpu;
+  return -1;
+}
+
+int rt_cpu_in_list(const char *path, int cpu) {
+  FILE *f = fopen(path, "r");
+  char list[1024];
+
+  if (!f)
+    return -1;
+  if (!fgets(list, sizeof(list), f))
+    list[0] = '\0';
+  fclose(f);
+
+  // Comma separated ranges: "2-5,7"
+  for (char *tok = strtok(list, ",\n"); tok; tok = strtok(NULL, ",\n")) {
+    char *dash;
+    int lo = strtol(tok, &dash, 10);
+    int hi = *dash == '-' ? atoi(dash + 1) : lo;
+    if (cpu >= lo && cpu <= hi)
+      return 1;
+  }
+  return 0;
+}
+
+void rt_report_isolation(int cpu) {
+  static const char *names[] = {"isolcpus", "nohz_full"};
+  static const char *paths[] = {"/sys/devices/system/cpu/isolated",
+                                "/sys/devices/system/cpu/nohz_full"};
+
+  for (int i = 0; i < 2; i++) {
+    int in = rt_cpu_in_list(paths[i], cpu);
+    const char *state = in < 0 ? "unknown (not reported)" : in ? "yes" : "no";
+    printf("  %-9s: core %d %s\n", names[i], cpu, state);
+  }
+}
+
+void rt_gaps_print(const rt_gaps_t *g, uint64_t tsc_hz, uint64_t span) {
+  printf("Preemption gaps (>= %d cycles): %lu, %.3f%% of the capture, "
+         "longest %.1f us\n",
+         RT_GAP_CYCLES, g->count, span ? 100.0 * g->cycles / span : 0.0,
+         g->max * 1e6 / tsc_hz);
+
+  for (int b = 0; b < RT_GAP_BUCKETS; b++) {
+    if (g->buckets[b] == 0)
+      continue;
+    double lo = (double)(1ULL << b) * 1e6 / tsc_hz;
+    printf("  %9.1f - %9.1f us: %lu\n", lo, 2 * lo, g->buckets[b]);
+  }
+}
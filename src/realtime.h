@@ -0,0 +1,55 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <stdint.h>
+
+// Capture loop scheduling helpers: SCHED_FIFO, checks for isolated and
+// tickless cores, and preemption gap detection.
+//
+// A busy capture loop reads the TSC every few hundred cycles. Two consecutive
+// reads further apart than RT_GAP_CYCLES mean the thread was not running in
+// between (interrupt, tick, another task), which separates scheduler noise
+// from cache noise in a capture.
+
+#define RT_GAP_CYCLES 10000
+#define RT_GAP_BUCKETS 48 // floor(log2(gap)) up to 2^47 cycles
+
+typedef struct {
+  uint64_t buckets[RT_GAP_BUCKETS];
+  uint64_t count;
+  uint64_t cycles; // total cycles spent descheduled
+  uint64_t max;
+} rt_gaps_t;
+
+// Switch the calling thread to SCHED_FIFO at the highest priority but one,
+// leaving room for kernel threads. Returns the priority, or -1 (errno set)
+// when not permitted.
+int rt_enable_fifo(void);
+
+// The CPU the calling thread is pinned to, or -1 if it may run on several.
+int rt_pinned_cpu(void);
+
+// Whether cpu appears in a sysfs CPU list such as
+// /sys/devices/system/cpu/isolated; -1 if the file is missing.
+int rt_cpu_in_list(const char *path, int cpu);
+
+// Print whether cpu is isolated (isolcpus) and tickless (nohz_full).
+void rt_report_isolation(int cpu);
+
+static inline void rt_gap_note(rt_gaps_t *g, uint64_t prev, uint64_t now) {
+  uint64_t gap = now - prev;
+  if (gap < RT_GAP_CYCLES)
+    return;
+
+  int bucket = 63 - __builtin_clzll(gap);
+  g->buckets[bucket < RT_GAP_BUCKETS ? bucket : RT_GAP_BUCKETS - 1]++;
+  g->count++;
+  g->cycles += gap;
+  if (gap > g->max)
+    g->max = gap;
+}
+
+// Print the gap histogram; span is the length of the capture in cycles.
+void rt_gaps_print(const rt_gaps_t *g, uint64_t tsc_hz, uint64_t span);
+
+#endif
@@ -0,0 +1,564 @@
+#include "trace.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+#define SMALL_PAGE_SIZE 4096UL
+
+void trace_header_init(trace_header_t *hdr, int num_lines) {
+  memset(hdr, 0, sizeof(*hdr));
+  memcpy(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic));
+  hdr->version = TRACE_VERSION;
+  hdr->header_size = sizeof(*hdr);
+  hdr->num_lines = num_lines;
+  strcpy(hdr->load_profile, "unknown");
+}
+
+void trace_header_set_rle(trace_header_t *hdr, uint32_t idle_floor) {
+  hdr->encoding = TRACE_ENCODING_RLE;
+  hdr->block_slots = TRACE_BLOCK_SLOTS;
+  hdr->idle_floor = idle_floor;
+}
+
+// Block payload: a tag byte per element. TAG_RUN is followed by the length
+// of an idle run; TAG_SLOT by the op_seq delta (with TAG_OP_SEQ), the flags
+// (with TAG_FLAGS), the tsc's distance from the slot grid and the latency
+// delta of every line, all varints, the signed ones zigzag-coded.
+#define TAG_RUN 0x00
+#define TAG_SLOT 0x01
+#define TAG_OP_SEQ 0x02
+#define TAG_FLAGS 0x04
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Returns NULL on a varint running past end
+static inline const uint8_t *get_varint(const uint8_t *p, const uint8_t *end,
+                                        uint64_t *v) {
+  uint64_t x = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    x |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      *v = x;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+static int slot_is_idle(const trace_header_t *hdr, const trace_record_t *rec,
+                        uint32_t prev_op_seq) {
+  if (hdr->idle_floor == 0 || rec->flags || rec->op_seq != prev_op_seq)
+    return 0;
+  for (uint32_t l = 0; l < hdr->num_lines; l++) {
+    if (rec->latency[l] < hdr->idle_floor)
+      return 0;
+  }
+  return 1;
+}
+
+size_t trace_encode_block(const trace_header_t *hdr, const trace_record_t *recs,
+                          size_t n, uint8_t *out) {
+  trace_block_t blk = {TRACE_BLOCK_MAGIC, 0, n, n ? recs[0].op_seq : 0,
+                       n ? recs[0].tsc : 0};
+  uint8_t *p = out + sizeof(blk);
+  // The encoder tracks what the decoder will have reconstructed
+  uint64_t prev_tsc = blk.tsc - hdr->slot_cycles;
+  uint32_t prev_op = blk.op_seq;
+  uint16_t prev_lat[TRACE_MAX_LINES] = {0xffff, 0xffff, 0xffff, 0xffff};
+  uint64_t run = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    const trace_record_t *rec = &recs[i];
+    if (slot_is_idle(hdr, rec, prev_op)) {
+      run++;
+      continue;
+    }
+    if (run) {
+      *p++ = TAG_RUN;
+      p = put_varint(p, run);
+      prev_tsc += run * hdr->slot_cycles;
+      for (uint32_t l = 0; l < hdr->num_lines; l++)
+        prev_lat[l] = 0xffff;
+      run = 0;
+    }
+
+    uint8_t tag = TAG_SLOT;
+    if (rec->op_seq != prev_op)
+      tag |= TAG_OP_SEQ;
+    if (rec->flags)
+      tag |= TAG_FLAGS;
+    *p++ = tag;
+    if (tag & TAG_OP_SEQ)
+      p = put_varint(p, (uint32_t)(rec->op_seq - prev_op));
+    if (tag & TAG_FLAGS)
+      p = put_varint(p, rec->flags);
+    p = put_varint(p, zigzag((int64_t)(rec->tsc - prev_tsc - hdr->slot_cycles)));
+    for (uint32_t l = 0; l < hdr->num_lines; l++) {
+      p = put_varint(p, zigzag((int64_t)rec->latency[l] - prev_lat[l]));
+      prev_lat[l] = rec->latency[l];
+    }
+    prev_tsc = rec->tsc;
+    prev_op = rec->op_seq;
+  }
+  if (run) {
+    *p++ = TAG_RUN;
+    p = put_varint(p, run);
+  }
+
+  blk.bytes = p - out - sizeof(blk);
+  memcpy(out, &blk, sizeof(blk));
+  return p - out;
+}
+
+int trace_decode_block(const trace_header_t *hdr, const trace_block_t *blk,
+                       const uint8_t *payload, trace_record_t *recs) {
+  const uint8_t *p = payload, *end = payload + blk->bytes;
+  uint64_t prev_tsc = blk->tsc - hdr->slot_cycles;
+  uint32_t prev_op = blk->op_seq;
+  uint16_t prev_lat[TRACE_MAX_LINES] = {0xffff, 0xffff, 0xffff, 0xffff};
+  size_t i = 0;
+
+  if (hdr->num_lines > TRACE_MAX_LINES)
+    return -1;
+  while (i < blk->slots) {
+    uint64_t v;
+    if (p == end)
+      return -1;
+    uint8_t tag = *p++;
+
+    if (tag == TAG_RUN) {
+      if (!(p = get_varint(p, end, &v)) || v > blk->slots - i)
+        return -1;
+      for (uint64_t k = 0; k < v; k++, i++) {
+        trace_record_t *rec = &recs[i];
+        memset(rec, 0, sizeof(*rec));
+        prev_tsc += hdr->slot_cycles;
+        rec->tsc = prev_tsc;
+        rec->op_seq = prev_op;
+        for (uint32_t l = 0; l < hdr->num_lines; l++)
+          rec->latency[l] = 0xffff;
+      }
+      for (uint32_t l = 0; l < hdr->num_lines; l++)
+        prev_lat[l] = 0xffff;
+      continue;
+    }
+
+    trace_record_t *rec = &recs[i++];
+    memset(rec, 0, sizeof(*rec));
+    if (tag & TAG_OP_SEQ) {
+      if (!(p = get_varint(p, end, &v)))
+        return -1;
+      prev_op += (uint32_t)v;
+    }
+    rec->op_seq = prev_op;
+    if (tag & TAG_FLAGS) {
+      if (!(p = get_varint(p, end, &v)))
+        return -1;
+      rec->flags = v;
+    }
+    if (!(p = get_varint(p, end, &v)))
+      return -1;
+    prev_tsc += hdr->slot_cycles + unzigzag(v);
+    rec->tsc = prev_tsc;
+    for (uint32_t l = 0; l < hdr->num_lines; l++) {
+      if (!(p = get_varint(p, end, &v)))
+        return -1;
+      prev_lat[l] += unzigzag(v);
+      rec->latency[l] = prev_lat[l];
+    }
+  }
+  return p == end ? 0 : -1;
+}
+
+const char *trace_engine_name(uint32_t engine) {
+  switch (engine) {
+  case TRACE_ENGINE_FLUSH_RELOAD:
+    return "flush+reload";
+  case TRACE_ENGINE_PRIME_PROBE:
+    return "prime+probe";
+  case TRACE_ENGINE_FLUSH_FLUSH:
+    return "flush+flush";
+  default:
+    return "unknown";
+  }
+}
+
+static int block_alloc(trace_file_t *tf) {
+  uint32_t slots = tf->header.block_slots;
+
+  if (tf->header.encoding == TRACE_ENCODING_RAW)
+    return 0;
+  if (tf->header.encoding != TRACE_ENCODING_RLE || slots == 0)
+    return -1;
+  tf->block = malloc(slots * sizeof(*tf->block));
+  tf->scratch = malloc(TRACE_BLOCK_MAX_BYTES(slots));
+  return tf->block && tf->scratch ? 0 : -1;
+}
+
+static void block_free(trace_file_t *tf) {
+  free(tf->block);
+  free(tf->scratch);
+  tf->block = NULL;
+  tf->scratch = NULL;
+}
+
+int trace_create(trace_file_t *tf, const char *path,
+                 const trace_header_t *hdr) {
+  memset(tf, 0, sizeof(*tf));
+  tf->header = *hdr;
+  tf->header.version = TRACE_VERSION;
+  tf->header.header_size = sizeof(tf->header);
+  tf->header.num_slots = 0;
+  if (block_alloc(tf) < 0) {
+    fprintf(stderr, "%s: unsupported trace encoding\n", path);
+    block_free(tf);
+    return -1;
+  }
+  tf->file = fopen(path, "w+b");
+  if (!tf->file) {
+    perror(path);
+    block_free(tf);
+    return -1;
+  }
+  tf->writing = 1;
+  if (fwrite(&tf->header, sizeof(tf->header), 1, tf->file) != 1) {
+    perror(path);
+    fclose(tf->file);
+    block_free(tf);
+    return -1;
+  }
+  tf->bytes = sizeof(tf->header);
+  return 0;
+}
+
+static int flush_block(trace_file_t *tf) {
+  if (tf->block_count == 0)
+    return 0;
+  size_t bytes = trace_encode_block(&tf->header, tf->block, tf->block_count,
+                                    tf->scratch);
+  if (fwrite(tf->scratch, 1, bytes, tf->file) != bytes)
+    return -1;
+  tf->bytes += bytes;
+  tf->block_count = 0;
+  return 0;
+}
+
+int trace_append(trace_file_t *tf, const trace_record_t *recs, size_t n) {
+  if (tf->header.encoding == TRACE_ENCODING_RAW) {
+    if (fwrite(recs, sizeof(*recs), n, tf->file) != n)
+      return -1;
+    tf->bytes += n * sizeof(*recs);
+    tf->header.num_slots += n;
+    return 0;
+  }
+
+  // Stream into blocks, encoding each as it fills
+  for (size_t i = 0; i < n;) {
+    size_t room = tf->header.block_slots - tf->block_count;
+    size_t take = n - i < room ? n - i : room;
+    memcpy(tf->block + tf->block_count, recs + i, take * sizeof(*recs));
+    tf->block_count += take;
+    tf->header.num_slots += take;
+    i += take;
+    if (tf->block_count == tf->header.block_slots && flush_block(tf) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+int trace_open(trace_file_t *tf, const char *path) {
+  // Fields added since version 1 read as zero, a raw trace
+  const size_t v1_size = offsetof(trace_header_t, encoding);
+
+  memset(tf, 0, sizeof(*tf));
+  tf->file = fopen(path, "rb");
+  if (!tf->file) {
+    perror(path);
+    return -1;
+  }
+  if (fread(&tf->header, v1_size, 1, tf->file) != 1 ||
+      memcmp(tf->header.magic, TRACE_MAGIC, sizeof(tf->header.magic)) != 0 ||
+      (tf->header.header_size != v1_size &&
+       tf->header.header_size != sizeof(tf->header)) ||
+      (tf->header.header_size > v1_size &&
+       fread((char *)&tf->header + v1_size, sizeof(tf->header) - v1_size, 1,
+             tf->file) != 1)) {
+    fprintf(stderr, "%s: not a trace file\n", path);
+    fclose(tf->file);
+    return -1;
+  }
+  if (block_alloc(tf) < 0) {
+    fprintf(stderr, "%s: unsupported trace encoding %u\n", path,
+            tf->header.encoding);
+    fclose(tf->file);
+    block_free(tf);
+    return -1;
+  }
+  tf->bytes = tf->header.header_size;
+  tf->writing = 0;
+  return 0;
+}
+
+// Read and decode the next block; 0 at the end of the file
+static int next_block(trace_file_t *tf) {
+  trace_block_t blk;
+
+  if (fread(&blk, sizeof(blk), 1, tf->file) != 1)
+    return 0;
+  if (blk.magic != TRACE_BLOCK_MAGIC || blk.slots == 0 ||
+      blk.slots > tf->header.block_slots ||
+      blk.bytes > TRACE_BLOCK_MAX_BYTES(blk.slots) - sizeof(blk) ||
+      fread(tf->scratch, 1, blk.bytes, tf->file) != blk.bytes ||
+      trace_decode_block(&tf->header, &blk, tf->scratch, tf->block) < 0) {
+    fprintf(stderr, "Corrupt trace block at byte %lu\n", tf->bytes);
+    return -1;
+  }
+  tf->bytes += sizeof(blk) + blk.bytes;
+  tf->block_count = blk.slots;
+  tf->block_pos = 0;
+  return 1;
+}
+
+size_t trace_read(trace_file_t *tf, trace_record_t *recs, size_t max) {
+  if (tf->header.encoding == TRACE_ENCODING_RAW) {
+    size_t n = fread(recs, sizeof(*recs), max, tf->file);
+    tf->bytes += n * sizeof(*recs);
+    return n;
+  }
+
+  size_t n = 0;
+  while (n < max) {
+    if (tf->block_pos == tf->block_count && next_block(tf) <= 0)
+      break;
+    size_t avail = tf->block_count - tf->block_pos;
+    size_t take = max - n < avail ? max - n : avail;
+    memcpy(recs + n, tf->block + tf->block_pos, take * sizeof(*recs));
+    tf->block_pos += take;
+    n += take;
+  }
+  return n;
+}
+
+int trace_close(trace_file_t *tf) {
+  int ret = 0;
+  if (tf->writing && flush_block(tf) < 0)
+    ret = -1;
+  if (tf->writing) {
+    // Rewrite the header now that the slot count is known
+    if (fseek(tf->file, 0, SEEK_SET) != 0 ||
+        fwrite(&tf->header, sizeof(tf->header), 1, tf->file) != 1)
+      ret = -1;
+  }
+  if (fclose(tf->file) != 0)
+    ret = -1;
+  block_free(tf);
+  return ret;
+}
+
+int trace_map_open(trace_map_t *tm, const char *path) {
+  const size_t v1_size = offsetof(trace_header_t, encoding);
+  struct stat st;
+
+  memset(tm, 0, sizeof(*tm));
+  tm->fd = open(path, O_RDONLY);
+  if (tm->fd < 0 || fstat(tm->fd, &st) < 0) {
+    perror(path);
+    if (tm->fd >= 0)
+      close(tm->fd);
+    return -1;
+  }
+  tm->map_bytes = st.st_size;
+  if (tm->map_bytes >= v1_size) {
+    void *map = mmap(NULL, tm->map_bytes, PROT_READ, MAP_SHARED, tm->fd, 0);
+    tm->map = map == MAP_FAILED ? NULL : map;
+  }
+  if (!tm->map) {
+    fprintf(stderr, "%s: cannot map trace\n", path);
+    close(tm->fd);
+    return -1;
+  }
+  madvise((void *)tm->map, tm->map_bytes, MADV_SEQUENTIAL);
+
+  // Same header rules as trace_open
+  memcpy(&tm->header, tm->map, v1_size);
+  uint32_t size = tm->header.header_size;
+  int ok = memcmp(tm->header.magic, TRACE_MAGIC, sizeof(tm->header.magic)) ==
+               0 &&
+           (size == v1_size || size == sizeof(tm->header)) &&
+           size <= tm->map_bytes;
+  if (ok && size > v1_size)
+    memcpy(&tm->header, tm->map, size);
+  if (ok && tm->header.encoding == TRACE_ENCODING_RAW)
+    ok = tm->map_bytes - size >= tm->header.num_slots * sizeof(trace_record_t);
+  if (ok && tm->header.encoding == TRACE_ENCODING_RLE)
+    ok = tm->header.block_slots > 0 &&
+         (tm->block = malloc(tm->header.block_slots * sizeof(*tm->block)));
+  else if (ok)
+    ok = tm->header.encoding == TRACE_ENCODING_RAW;
+  if (!ok) {
+    fprintf(stderr, "%s: not a trace file or truncated\n", path);
+    trace_map_close(tm);
+    return -1;
+  }
+  tm->pos = size;
+  return 0;
+}
+
+// Release the pages wholly before the current chunk
+static void map_drop_behind(trace_map_t *tm, size_t upto) {
+  size_t page = SMALL_PAGE_SIZE;
+  size_t end = upto & ~(page - 1);
+  if (end > tm->dropped) {
+    madvise((char *)tm->map + tm->dropped, end - tm->dropped, MADV_DONTNEED);
+    tm->dropped = end;
+  }
+}
+
+long trace_map_next(trace_map_t *tm, const trace_record_t **recs) {
+  map_drop_behind(tm, tm->pos);
+  if (tm->slots >= tm->header.num_slots)
+    return 0;
+
+  if (tm->header.encoding == TRACE_ENCODING_RAW) {
+    uint64_t left = tm->header.num_slots - tm->slots;
+    size_t n = left < TRACE_MAP_CHUNK_SLOTS ? left : TRACE_MAP_CHUNK_SLOTS;
+    *recs = (const trace_record_t *)(tm->map + tm->pos);
+    tm->pos += n * sizeof(trace_record_t);
+    tm->slots += n;
+    return n;
+  }
+
+  trace_block_t blk;
+  if (tm->map_bytes - tm->pos < sizeof(blk))
+    return -1;
+  memcpy(&blk, tm->map + tm->pos, sizeof(blk));
+  if (blk.magic != TRACE_BLOCK_MAGIC || blk.slots == 0 ||
+      blk.slots > tm->header.block_slots ||
+      blk.bytes > tm->map_bytes - tm->pos - sizeof(blk) ||
+      trace_decode_block(&tm->header, &blk, tm->map + tm->pos + sizeof(blk),
+                         tm->block) < 0) {
+    fprintf(stderr, "Corrupt trace block at byte %zu\n", tm->pos);
+    return -1;
+  }
+  tm->pos += sizeof(blk) + blk.bytes;
+  tm->slots += blk.slots;
+  *recs = tm->block;
+  return blk.slots;
+}
+
+int trace_map_seek(trace_map_t *tm, size_t pos, uint64_t slot) {
+  if (pos < tm->header.header_size || pos > tm->map_bytes ||
+      slot > tm->header.num_slots)
+    return -1;
+  if (tm->header.encoding == TRACE_ENCODING_RAW &&
+      pos != tm->header.header_size + slot * sizeof(trace_record_t))
+    return -1;
+  tm->pos = pos;
+  tm->slots = slot;
+  // Pages from here on may be faulted in again
+  if (tm->dropped > pos)
+    tm->dropped = pos & ~(SMALL_PAGE_SIZE - 1);
+  return 0;
+}
+
+void trace_map_close(trace_map_t *tm) {
+  if (tm->map)
+    munmap((void *)tm->map, tm->map_bytes);
+  if (tm->fd >= 0)
+    close(tm->fd);
+  free(tm->block);
+  memset(tm, 0, sizeof(*tm));
+  tm->fd = -1;
+}
+
+int trace_buffer_alloc(trace_buffer_t *buf, size_t count, int flags) {
+  size_t size = count * sizeof(trace_record_t);
+  void *mem = MAP_FAILED;
+
+  memset(buf, 0, sizeof(*buf));
+  if (flags & TRACE_BUF_HUGEPAGE)
+    flags |= TRACE_BUF_PREFAULT;
+  buf->flags = flags;
+
+  if (flags & TRACE_BUF_HUGEPAGE) {
+    buf->bytes = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    mem = mmap(NULL, buf->bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1,
+               0);
+    buf->hugetlb = mem != MAP_FAILED;
+  }
+  if (mem == MAP_FAILED) {
+    // No reserved huge pages: fall back to 4K pages, asking for THP
+    buf->bytes = (size + SMALL_PAGE_SIZE - 1) & ~(SMALL_PAGE_SIZE - 1);
+    mem = mmap(NULL, buf->bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS |
+                   (flags & TRACE_BUF_PREFAULT ? MAP_POPULATE : 0),
+               -1, 0);
+    if (mem == MAP_FAILED) {
+      perror("mmap trace buffer");
+      return -1;
+    }
+    if (flags & TRACE_BUF_HUGEPAGE)
+      madvise(mem, buf->bytes, MADV_HUGEPAGE);
+  }
+
+  if (flags & TRACE_BUF_PREFAULT) {
+    // MAP_POPULATE maps the zero page read-only on some kernels; writing
+    // every page forces private copies now rather than during the capture
+    for (size_t off = 0; off < buf->bytes; off += SMALL_PAGE_SIZE)
+      ((volatile char *)mem)[off] = 0;
+    buf->locked = mlock(mem, buf->bytes) == 0;
+    if (!buf->locked)
+      perror("mlock trace buffer (check ulimit -l)");
+  }
+
+  buf->records = mem;
+  buf->count = count;
+  return 0;
+}
+
+void trace_buffer_free(trace_buffer_t *buf) {
+  if (!buf->records)
+    return;
+  if (buf->locked)
+    munlock(buf->records, buf->bytes);
+  munmap(buf->records, buf->bytes);
+  buf->records = NULL;
+}
+
+const char *trace_buffer_describe(const trace_buffer_t *buf) {
+  static char desc[64];
+  const char *backing = "";
+
+  if (!(buf->flags & TRACE_BUF_PREFAULT))
+    return "demand-paged";
+  if (buf->hugetlb)
+    backing = "hugetlb, ";
+  else if (buf->flags & TRACE_BUF_HUGEPAGE)
+    backing = "THP, ";
+  snprintf(desc, sizeof(desc), "%sprefaulted%s", backing,
+           buf->locked ? ", mlock'd" : "");
+  return desc;
+}
@@ -0,0 +1,209 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Capture trace file: one header followed by the records of every time slot,
+// either stored raw at a fixed size each or encoded in blocks
+// (TRACE_ENCODING_RLE). Records keep the raw reload latency of every
+// monitored line, so thresholds can be revisited offline.
+
+#define TRACE_MAGIC "FRTRACE1"
+#define TRACE_VERSION 2 // version 1 headers end before `encoding`
+#define TRACE_MAX_LINES 4
+#define TRACE_NAME_LEN 16
+#define TRACE_PROFILE_LEN 128
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t num_lines;
+  uint32_t threshold;
+  uint64_t slot_cycles;
+  uint64_t tsc_hz;
+  uint64_t num_slots;
+  char line_names[TRACE_MAX_LINES][TRACE_NAME_LEN];
+  uint64_t line_offsets[TRACE_MAX_LINES]; // offsets in the target file
+  char load_profile[TRACE_PROFILE_LEN];   // co-located load during capture
+  uint32_t load_changed;                  // profile changed mid-capture
+  uint32_t engine;                        // TRACE_ENGINE_*
+  uint32_t encoding;                      // TRACE_ENCODING_*
+  uint32_t block_slots;                   // slots per block when encoded
+  uint32_t idle_floor;                    // see TRACE_ENCODING_RLE
+  uint32_t reserved;
+} trace_header_t;
+
+// Record storage. RLE files hold independently decodable blocks of up to
+// block_slots records, each starting from an absolute tsc and op_seq.
+// Within a block, a slot with no flags, the previous slot's op_seq and every
+// latency at or above idle_floor is idle; runs of idle slots are stored as
+// a count and read back with saturated latencies (0xffff) and tsc on the
+// slot grid. Any threshold up to idle_floor therefore decodes the same as
+// on the raw trace. Other slots store their fields as varint deltas from
+// the previous slot. An idle_floor of 0, the tools' default, keeps every
+// record exact.
+#define TRACE_ENCODING_RAW 0
+#define TRACE_ENCODING_RLE 1
+#define TRACE_BLOCK_SLOTS 4096
+
+#define TRACE_BLOCK_MAGIC 0x4b4c4246 // "FBLK"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t bytes;  // encoded payload following this header
+  uint32_t slots;
+  uint32_t op_seq; // first slot's
+  uint64_t tsc;    // first slot's
+} trace_block_t;
+
+// Worst-case encoded size of a block of n records, header included
+#define TRACE_BLOCK_MAX_BYTES(n) (sizeof(trace_block_t) + (size_t)(n) * 40)
+
+
+// Probe engine that captured the trace. Flush+Reload stores reload latencies
+// directly; engines with per-line thresholds store trace_margin_*() values
+// and set the header threshold to TRACE_MARGIN_ZERO, so that a latency below
+// the threshold means a hit for every engine.
+#define TRACE_ENGINE_FLUSH_RELOAD 0
+#define TRACE_ENGINE_PRIME_PROBE 1
+#define TRACE_ENGINE_FLUSH_FLUSH 2
+#define TRACE_MARGIN_ZERO 0x8000
+
+// Record flags. Slot k is scheduled at t0 + k * slot_cycles; a slot whose
+// probes end past the next deadline, or that was never sampled because the
+// loop fell a whole slot behind, does not cover its nominal window.
+#define TRACE_SLOT_OVERRUN 0x1 // probes finished after the slot's end
+#define TRACE_SLOT_MISSED 0x2  // not sampled, latencies saturated
+#define TRACE_SLOT_CORRUPT (TRACE_SLOT_OVERRUN | TRACE_SLOT_MISSED)
+
+typedef struct {
+  uint64_t tsc;    // slot start (the deadline for missed slots)
+  uint32_t op_seq; // victim operation sequence seen at slot start
+  uint16_t flags;  // TRACE_SLOT_*
+  uint16_t latency[TRACE_MAX_LINES]; // reload cycles or margin, TRACE_ENGINE_*
+} trace_record_t;
+
+// Encode n records (at most hdr->block_slots) as one block; returns bytes
+// written to out, which must hold TRACE_BLOCK_MAX_BYTES(n).
+size_t trace_encode_block(const trace_header_t *hdr, const trace_record_t *recs,
+                          size_t n, uint8_t *out);
+// Decode the payload of a block into blk->slots records. Returns -1 if the
+// payload is malformed.
+int trace_decode_block(const trace_header_t *hdr, const trace_block_t *blk,
+                       const uint8_t *payload, trace_record_t *recs);
+
+typedef struct {
+  FILE *file;
+  trace_header_t header;
+  int writing;
+  uint64_t bytes; // file size so far, header included
+
+  // Encoded files: the block being filled or read back
+  trace_record_t *block;
+  size_t block_count;
+  size_t block_pos;
+  uint8_t *scratch; // encoded form of the block
+} trace_file_t;
+
+void trace_header_init(trace_header_t *hdr, int num_lines);
+// Store records as TRACE_ENCODING_RLE with the given idle floor
+void trace_header_set_rle(trace_header_t *hdr, uint32_t idle_floor);
+
+static inline uint16_t trace_latency(uint64_t cycles) {
+  return cycles > 0xffff ? 0xffff : (uint16_t)cycles;
+}
+
+static inline uint16_t trace_clamp_margin(int64_t m) {
+  return m < 0 ? 0 : m > 0xffff ? 0xffff : (uint16_t)m;
+}
+
+// Encode a probe time against a per-line threshold so that hits land below
+// TRACE_MARGIN_ZERO: for engines whose hits are slower than the threshold...
+static inline uint16_t trace_margin_above(uint64_t time, uint64_t threshold) {
+  return trace_clamp_margin((int64_t)TRACE_MARGIN_ZERO + (int64_t)threshold -
+                            (int64_t)time);
+}
+
+// ...and for engines whose hits are faster than it
+static inline uint16_t trace_margin_below(uint64_t time, uint64_t threshold) {
+  return trace_clamp_margin((int64_t)TRACE_MARGIN_ZERO + (int64_t)time -
+                            (int64_t)threshold);
+}
+
+// A slot the capture fell behind on: stamped with its deadline and the
+// victim's op_seq at the time, so a gap inside an operation does not end it
+// early and split it in two.
+static inline void trace_record_missed(trace_record_t *rec, uint64_t deadline,
+                                       uint32_t op_seq) {
+  rec->tsc = deadline;
+  rec->op_seq = op_seq;
+  rec->flags = TRACE_SLOT_MISSED;
+  for (int i = 0; i < TRACE_MAX_LINES; i++)
+    rec->latency[i] = 0xffff;
+}
+
+const char *trace_engine_name(uint32_t engine);
+
+// Records are encoded as the header's encoding asks, a block at a time
+int trace_create(trace_file_t *tf, const char *path, const trace_header_t *hdr);
+int trace_append(trace_file_t *tf, const trace_record_t *recs, size_t n);
+
+// Reads decode transparently. Version 1 files read as raw.
+int trace_open(trace_file_t *tf, const char *path);
+size_t trace_read(trace_file_t *tf, trace_record_t *recs, size_t max);
+
+// Flushes the last block and finalises the slot count of a file being
+// written, then closes it.
+int trace_close(trace_file_t *tf);
+
+// Memory-mapped reading for offline analysis of captures larger than RAM.
+// The mapping is read front to back under MADV_SEQUENTIAL, and pages behind
+// the current chunk are dropped with MADV_DONTNEED, so resident memory stays
+// at about one chunk whatever the file size. Raw chunks point into the
+// mapping; encoded ones are decoded a block at a time into a buffer.
+#define TRACE_MAP_CHUNK_SLOTS 65536 // raw records per chunk
+
+typedef struct {
+  int fd;
+  const uint8_t *map;
+  size_t map_bytes;
+  trace_header_t header;
+  size_t pos;       // byte offset of the next chunk
+  size_t dropped;   // bytes before this were released
+  uint64_t slots;   // slots returned so far
+  trace_record_t *block; // decoded block of an encoded file
+} trace_map_t;
+
+int trace_map_open(trace_map_t *tm, const char *path);
+// Point *recs at the next chunk of records. Returns the number of records,
+// 0 at the end of the trace, -1 on a malformed block.
+long trace_map_next(trace_map_t *tm, const trace_record_t **recs);
+// Continue reading at a chunk start seen earlier: the pos and slots of the
+// map just before a trace_map_next call. Raw files accept any slot.
+int trace_map_seek(trace_map_t *tm, size_t pos, uint64_t slot);
+void trace_map_close(trace_map_t *tm);
+
+// In-memory capture buffers. A demand-paged buffer takes a page fault on the
+// first record written to each page, inside the timed slot; prefaulted
+// buffers are touched and mlock'd before the capture starts.
+#define TRACE_BUF_PREFAULT 0x1 // touch and mlock every page up front
+#define TRACE_BUF_HUGEPAGE 0x2 // back with 2 MB pages, implies PREFAULT
+
+typedef struct {
+  trace_record_t *records;
+  size_t count;
+  size_t bytes;  // mapping size, rounded up to the page size used
+  int flags;     // TRACE_BUF_* requested
+  int hugetlb;   // backed by hugetlbfs pages rather than THP or 4K pages
+  int locked;    // mlock succeeded
+} trace_buffer_t;
+
+int trace_buffer_alloc(trace_buffer_t *buf, size_t count, int flags);
+void trace_buffer_free(trace_buffer_t *buf);
+// Short description of the backing, e.g. "hugetlb, mlock'd"
+const char *trace_buffer_describe(const trace_buffer_t *buf);
+
+#endif
@@ -0,0 +1,248 @@
+#include "trace_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "analysis.h"
+
+// Chunk starts seen while scanning; an operation of an encoded trace can
+// begin in a block before the one that ends it
+typedef struct {
+  uint64_t pos;
+  uint64_t slot;
+} chunk_start_t;
+
+typedef struct {
+  const trace_header_t *header;
+  trace_index_entry_t *entries;
+  size_t count;
+  size_t cap;
+  chunk_start_t *chunks;
+  size_t num_chunks;
+  size_t chunks_cap;
+  int error;
+} index_builder_t;
+
+static int grow(void **array, size_t *cap, size_t need, size_t size) {
+  if (need <= *cap)
+    return 0;
+  size_t new_cap = *cap ? 2 * *cap : 1024;
+  void *p = realloc(*array, new_cap * size);
+  if (!p)
+    return -1;
+  *array = p;
+  *cap = new_cap;
+  return 0;
+}
+
+static void index_segment(const trace_record_t *slots, size_t n,
+                          uint64_t first_slot, void *arg) {
+  index_builder_t *b = arg;
+
+  if (b->error || grow((void **)&b->entries, &b->cap, b->count + 1,
+                       sizeof(*b->entries)) < 0) {
+    b->error = 1;
+    return;
+  }
+  trace_index_entry_t *e = &b->entries[b->count++];
+  e->first_slot = first_slot;
+  e->slots = n;
+  e->tsc_begin = slots[0].tsc;
+  e->tsc_end = slots[n - 1].tsc;
+
+  if (b->header->encoding == TRACE_ENCODING_RAW) {
+    e->pos = b->header->header_size + first_slot * sizeof(trace_record_t);
+    e->pos_slot = first_slot;
+    return;
+  }
+  // Last chunk starting at or before the operation
+  size_t lo = 0, hi = b->num_chunks;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (b->chunks[mid].slot <= first_slot)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  e->pos = b->chunks[lo].pos;
+  e->pos_slot = b->chunks[lo].slot;
+}
+
+int trace_index_build(const char *trace_path, trace_index_t *idx) {
+  trace_map_t tm;
+  rsa_stream_t stream;
+  index_builder_t b = {0};
+  struct stat st;
+
+  memset(idx, 0, sizeof(*idx));
+  if (stat(trace_path, &st) < 0) {
+    perror(trace_path);
+    return -1;
+  }
+  if (trace_map_open(&tm, trace_path) < 0)
+    return -1;
+  b.header = &tm.header;
+  rsa_stream_init(&stream, RSA_STREAM_MAX_SLOTS);
+
+  const trace_record_t *recs;
+  long n;
+  for (;;) {
+    if (grow((void **)&b.chunks, &b.chunks_cap, b.num_chunks + 1,
+             sizeof(*b.chunks)) < 0) {
+      b.error = 1;
+      break;
+    }
+    b.chunks[b.num_chunks] = (chunk_start_t){tm.pos, tm.slots};
+    if ((n = trace_map_next(&tm, &recs)) <= 0)
+      break;
+    b.num_chunks++;
+    if (rsa_stream_feed(&stream, recs, n, index_segment, &b) < 0 || b.error) {
+      b.error = 1;
+      break;
+    }
+  }
+  if (n < 0)
+    b.error = 1;
+
+  uint64_t trace_slots = tm.header.num_slots;
+  rsa_stream_free(&stream);
+  trace_map_close(&tm);
+  free(b.chunks);
+  if (b.error) {
+    fprintf(stderr, "%s: cannot index trace\n", trace_path);
+    free(b.entries);
+    return -1;
+  }
+
+  memcpy(idx->header.magic, TRACE_INDEX_MAGIC, sizeof(idx->header.magic));
+  idx->header.version = TRACE_INDEX_VERSION;
+  idx->header.entry_size = sizeof(trace_index_entry_t);
+  idx->header.count = b.count;
+  idx->header.trace_bytes = st.st_size;
+  idx->header.trace_slots = trace_slots;
+  idx->header.trace_mtime_sec = st.st_mtim.tv_sec;
+  idx->header.trace_mtime_nsec = st.st_mtim.tv_nsec;
+  idx->entries = b.entries;
+  return 0;
+}
+
+int trace_index_save(const trace_index_t *idx, const char *index_path) {
+  FILE *f = fopen(index_path, "wb");
+  if (!f) {
+    perror(index_path);
+    return -1;
+  }
+  int ret = 0;
+  if (fwrite(&idx->header, sizeof(idx->header), 1, f) != 1 ||
+      fwrite(idx->entries, sizeof(*idx->entries), idx->header.count, f) !=
+          idx->header.count)
+    ret = -1;
+  if (fclose(f) != 0)
+    ret = -1;
+  if (ret)
+    fprintf(stderr, "Failed to write index %s\n", index_path);
+  return ret;
+}
+
+void trace_index_path(const char *trace_path, char *path, size_t size) {
+  snprintf(path, size, "%s.idx", trace_path);
+}
+
+// Load an index that still matches the trace; -1 otherwise
+static int index_load(const char *trace_path, const char *index_path,
+                      trace_index_t *idx) {
+  struct stat st;
+  trace_index_header_t hdr;
+
+  if (stat(trace_path, &st) < 0)
+    return -1;
+  FILE *f = fopen(index_path, "rb");
+  if (!f)
+    return -1;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, TRACE_INDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+      hdr.version != TRACE_INDEX_VERSION ||
+      hdr.entry_size != sizeof(trace_index_entry_t) ||
+      hdr.trace_bytes != (uint64_t)st.st_size ||
+      hdr.trace_mtime_sec != st.st_mtim.tv_sec ||
+      hdr.trace_mtime_nsec != st.st_mtim.tv_nsec) {
+    fclose(f);
+    return -1;
+  }
+  idx->header = hdr;
+  idx->entries = malloc((hdr.count ? hdr.count : 1) * sizeof(*idx->entries));
+  if (!idx->entries ||
+      fread(idx->entries, sizeof(*idx->entries), hdr.count, f) != hdr.count) {
+    free(idx->entries);
+    idx->entries = NULL;
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  return 0;
+}
+
+int trace_index_open(const char *trace_path, trace_index_t *idx, int *built) {
+  char index_path[4096];
+
+  trace_index_path(trace_path, index_path, sizeof(index_path));
+  if (index_load(trace_path, index_path, idx) == 0) {
+    if (built)
+      *built = 0;
+    return 0;
+  }
+  if (trace_index_build(trace_path, idx) < 0)
+    return -1;
+  // A read-only directory still gets a working index, just not a saved one
+  trace_index_save(idx, index_path);
+  if (built)
+    *built = 1;
+  return 0;
+}
+
+void trace_index_free(trace_index_t *idx) {
+  free(idx->entries);
+  memset(idx, 0, sizeof(*idx));
+}
+
+size_t trace_index_find_tsc(const trace_index_t *idx, uint64_t tsc) {
+  size_t lo = 0, hi = idx->header.count;
+
+  // Operations are in trace order and do not overlap
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (idx->entries[mid].tsc_end < tsc)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+int trace_index_read(trace_map_t *tm, const trace_index_entry_t *entry,
+                     trace_record_t *out) {
+  uint64_t slot = entry->pos_slot;
+  uint64_t end = entry->first_slot + entry->slots;
+  size_t copied = 0;
+
+  if (trace_map_seek(tm, entry->pos, entry->pos_slot) < 0)
+    return -1;
+  while (copied < entry->slots) {
+    const trace_record_t *recs;
+    long n = trace_map_next(tm, &recs);
+    if (n <= 0)
+      return -1;
+    // Overlap of this chunk with the operation
+    uint64_t from = slot > entry->first_slot ? slot : entry->first_slot;
+    uint64_t to = slot + n < end ? slot + n : end;
+    if (to > from) {
+      memcpy(out + copied, recs + (from - slot),
+             (to - from) * sizeof(*recs));
+      copied += to - from;
+    }
+    slot += n;
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_INDEX_H
+#define TRACE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+// Sidecar index of a trace file (TRACE.idx): one entry per victim operation,
+// as split by rsa_segment_next, with where its slots start in the file and
+// the tsc range they cover. Tools can then read operation N, or the
+// operations of a time window, without scanning the trace.
+
+#define TRACE_INDEX_MAGIC "FRTINDEX"
+#define TRACE_INDEX_VERSION 2
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_size;
+  uint64_t count;
+  // The trace described; a mismatch makes the index stale
+  uint64_t trace_bytes;
+  uint64_t trace_slots;
+  // mtime to the nanosecond: a trace rewritten within the same second at
+  // the same size is still caught
+  int64_t trace_mtime_sec;
+  int64_t trace_mtime_nsec;
+} trace_index_header_t;
+
+typedef struct {
+  uint64_t first_slot; // of the operation
+  uint64_t slots;
+  uint64_t pos;        // chunk start holding first_slot, for trace_map_seek
+  uint64_t pos_slot;   // trace slot at pos
+  uint64_t tsc_begin;  // first slot's tsc
+  uint64_t tsc_end;    // last slot's tsc
+} trace_index_entry_t;
+
+typedef struct {
+  trace_index_header_t header;
+  trace_index_entry_t *entries;
+} trace_index_t;
+
+// Scan a trace through trace_map and index every operation
+int trace_index_build(const char *trace_path, trace_index_t *idx);
+int trace_index_save(const trace_index_t *idx, const char *index_path);
+// Load TRACE.idx, or build and save it when missing or stale. *built tells
+// which happened and may be NULL.
+int trace_index_open(const char *trace_path, trace_index_t *idx, int *built);
+void trace_index_free(trace_index_t *idx);
+
+// "TRACE.idx"
+void trace_index_path(const char *trace_path, char *path, size_t size);
+
+// First operation whose slots end at or after tsc; count if none does
+size_t trace_index_find_tsc(const trace_index_t *idx, uint64_t tsc);
+
+// Read the slots of one operation into out, which holds entry->slots
+// records. Returns 0, or -1 if the trace does not match the entry.
+int trace_index_read(trace_map_t *tm, const trace_index_entry_t *entry,
+                     trace_record_t *out);
+
+#endif
@@ -0,0 +1,851 @@
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analysis.h"
+#include "trace.h"
+#include "trace_index.h"
+#include "workpool.h"
+
+// Offline trace utility: inspect a saved capture, convert it between raw and
+// RLE storage, measure the RLE encoder on it, decode it one victim
+// operation at a time from a memory mapping, jump to single operations
+// through its sidecar index, and score whole sweeps of captures in parallel.
+
+#define BENCH_MIN_SECONDS 0.2 // repeat timed passes until at least this long
+
+static double monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *encoding_name(uint32_t encoding) {
+  switch (encoding) {
+  case TRACE_ENCODING_RAW:
+    return "raw";
+  case TRACE_ENCODING_RLE:
+    return "rle";
+  default:
+    return "unknown";
+  }
+}
+
+// Read a whole trace; the caller frees the records
+static trace_record_t *load_trace(const char *path, trace_header_t *hdr,
+                                  uint64_t *file_bytes) {
+  trace_file_t tf;
+
+  if (trace_open(&tf, path) < 0)
+    return NULL;
+  size_t n = tf.header.num_slots;
+  trace_record_t *recs = malloc((n ? n : 1) * sizeof(*recs));
+  if (!recs || trace_read(&tf, recs, n) != n) {
+    fprintf(stderr, "%s: truncated trace\n", path);
+    free(recs);
+    trace_close(&tf);
+    return NULL;
+  }
+  *hdr = tf.header;
+  if (file_bytes)
+    *file_bytes = tf.bytes;
+  trace_close(&tf);
+  return recs;
+}
+
+static int print_info(const char *path) {
+  trace_file_t tf;
+
+  if (trace_open(&tf, path) < 0)
+    return 1;
+  const trace_header_t *hdr = &tf.header;
+  printf("Trace: %s (version %u)\n", path, hdr->version);
+  printf("Engine: %s, %u lines, threshold %u\n",
+         trace_engine_name(hdr->engine), hdr->num_lines, hdr->threshold);
+  for (uint32_t l = 0; l < hdr->num_lines && l < TRACE_MAX_LINES; l++)
+    printf("  %-10s +0x%lx\n", hdr->line_names[l], hdr->line_offsets[l]);
+  printf("Slots: %lu of %lu cycles at %lu Hz\n", hdr->num_slots,
+         hdr->slot_cycles, hdr->tsc_hz);
+  printf("Load profile: %s%s\n", hdr->load_profile,
+         hdr->load_changed ? " (changed during capture)" : "");
+  printf("Encoding: %s", encoding_name(hdr->encoding));
+  if (hdr->encoding == TRACE_ENCODING_RLE)
+    printf(", %u slots per block, idle floor %u", hdr->block_slots,
+           hdr->idle_floor);
+  printf("\n");
+  trace_close(&tf);
+  return 0;
+}
+
+static int convert(const char *in, const char *out, int rle,
+                   long idle_floor) {
+  trace_header_t hdr;
+  uint64_t in_bytes;
+  trace_record_t *recs = load_trace(in, &hdr, &in_bytes);
+  if (!recs)
+    return 1;
+  uint32_t in_encoding = hdr.encoding;
+
+  if (rle) {
+    trace_header_set_rle(&hdr, idle_floor);
+    if (idle_floor)
+      fprintf(stderr, "Warning: idle floor %ld is lossy, slots at or above it "
+                      "read back saturated\n", idle_floor);
+  } else {
+    hdr.encoding = TRACE_ENCODING_RAW;
+    hdr.block_slots = 0;
+    hdr.idle_floor = 0;
+  }
+
+  trace_file_t tf;
+  int ret = 0;
+  if (trace_create(&tf, out, &hdr) < 0) {
+    free(recs);
+    return 1;
+  }
+  if (trace_append(&tf, recs, hdr.num_slots) < 0)
+    ret = 1;
+  if (trace_close(&tf) < 0)
+    ret = 1;
+  if (ret) {
+    fprintf(stderr, "Failed to write %s\n", out);
+  } else {
+    // tf.bytes counts the last block, written on close
+    printf("%s (%s, %lu bytes) -> %s (%s, %lu bytes), ratio %.2f\n", in,
+           encoding_name(in_encoding), in_bytes, out,
+           encoding_name(hdr.encoding), tf.bytes,
+           tf.bytes ? (double)in_bytes / tf.bytes : 0.0);
+  }
+  free(recs);
+  return ret;
+}
+
+// 0 if a decoded record is exact, 1 if it was read back as idle (saturated,
+// tsc on the grid), which reads the same for any threshold up to the idle
+// floor, -1 if it differs otherwise
+static int compare_record(const trace_header_t *hdr,
+                          const trace_record_t *orig,
+                          const trace_record_t *dec) {
+  if (orig->op_seq != dec->op_seq || orig->flags != dec->flags)
+    return -1;
+  int exact = orig->tsc == dec->tsc;
+  for (uint32_t l = 0; l < hdr->num_lines; l++)
+    exact &= orig->latency[l] == dec->latency[l];
+  if (exact)
+    return 0;
+  if (hdr->idle_floor == 0 || orig->flags)
+    return -1;
+  for (uint32_t l = 0; l < hdr->num_lines; l++) {
+    if (dec->latency[l] != 0xffff || orig->latency[l] < hdr->idle_floor)
+      return -1;
+  }
+  return 1;
+}
+
+static int bench(const char *path, long idle_floor) {
+  trace_header_t hdr;
+  trace_record_t *recs = load_trace(path, &hdr, NULL);
+  if (!recs)
+    return 1;
+
+  size_t n = hdr.num_slots;
+  trace_header_set_rle(&hdr, idle_floor);
+  size_t blocks = (n + hdr.block_slots - 1) / hdr.block_slots;
+  uint8_t *enc = malloc(TRACE_BLOCK_MAX_BYTES(hdr.block_slots) *
+                        (blocks ? blocks : 1));
+  size_t *offsets = malloc((blocks + 1) * sizeof(*offsets));
+  trace_record_t *dec = malloc((n ? n : 1) * sizeof(*dec));
+  if (!enc || !offsets || !dec) {
+    fprintf(stderr, "Out of memory\n");
+    free(enc);
+    free(offsets);
+    free(dec);
+    free(recs);
+    return 1;
+  }
+
+  // Encode every block, repeating until the timing is meaningful
+  double start = monotonic_seconds(), encode_time;
+  int encode_passes = 0;
+  do {
+    size_t off = 0;
+    for (size_t b = 0; b < blocks; b++) {
+      size_t first = b * hdr.block_slots;
+      size_t count = n - first < hdr.block_slots ? n - first : hdr.block_slots;
+      offsets[b] = off;
+      off += trace_encode_block(&hdr, recs + first, count, enc + off);
+    }
+    offsets[blocks] = off;
+    encode_passes++;
+    encode_time = monotonic_seconds() - start;
+  } while (encode_time < BENCH_MIN_SECONDS);
+
+  start = monotonic_seconds();
+  double decode_time;
+  int decode_passes = 0, corrupt = 0;
+  do {
+    for (size_t b = 0; b < blocks; b++) {
+      trace_block_t blk;
+      memcpy(&blk, enc + offsets[b], sizeof(blk));
+      corrupt |= trace_decode_block(&hdr, &blk,
+                                    enc + offsets[b] + sizeof(blk),
+                                    dec + b * hdr.block_slots) < 0;
+    }
+    decode_passes++;
+    decode_time = monotonic_seconds() - start;
+  } while (decode_time < BENCH_MIN_SECONDS && !corrupt);
+
+  size_t idle = 0, mismatched = 0;
+  for (size_t i = 0; i < n && !corrupt; i++) {
+    int cmp = compare_record(&hdr, &recs[i], &dec[i]);
+    idle += cmp == 1;
+    mismatched += cmp < 0;
+  }
+
+  double raw_mb = (double)n * sizeof(trace_record_t) / 1e6;
+  size_t bytes = offsets[blocks] + sizeof(hdr);
+  printf("\n=== TRACE ENCODING RESULTS ===\n");
+  printf("Trace: %zu slots, %u lines, idle floor %u, %u slots per block\n", n,
+         hdr.num_lines, hdr.idle_floor, hdr.block_slots);
+  printf("Size: %.2f MB raw, %.3f MB encoded in %zu blocks, ratio %.2f\n",
+         raw_mb, bytes / 1e6, blocks, bytes ? raw_mb * 1e6 / bytes : 0.0);
+  printf("Encode: %.0f MB/s (%d passes)\n",
+         encode_time > 0 ? raw_mb * encode_passes / encode_time : 0.0,
+         encode_passes);
+  if (corrupt) {
+    printf("Decode: FAILED, encoded blocks did not decode\n");
+  } else {
+    printf("Decode: %.0f MB/s (%d passes)\n",
+           decode_time > 0 ? raw_mb * decode_passes / decode_time : 0.0,
+           decode_passes);
+    printf("Round trip: %zu slots differ, %zu read back as idle\n",
+           mismatched, idle);
+  }
+
+  free(enc);
+  free(offsets);
+  free(dec);
+  free(recs);
+  return corrupt || mismatched ? 1 : 0;
+}
+
+typedef struct {
+  int threshold;
+  const rsa_truth_t *truth; // NULL without --key
+  int print_bits;
+  uint64_t segments;
+  uint64_t decoded;
+  uint64_t bits;
+  rsa_score_t score;
+} analyze_ctx_t;
+
+static void analyze_segment(const trace_record_t *slots, size_t n,
+                            uint64_t first_slot, void *arg) {
+  analyze_ctx_t *ctx = arg;
+  char bits[RSA_MAX_BITS];
+
+  size_t len = rsa_decode(slots, n, ctx->threshold, bits, sizeof(bits));
+  if (ctx->print_bits)
+    printf("Operation %lu (slot %lu, %zu slots): %.*s\n", ctx->segments,
+           first_slot, n, (int)len, bits);
+  ctx->segments++;
+  ctx->decoded += len > 0;
+  ctx->bits += len;
+  if (ctx->truth)
+    rsa_score_segment(slots, n, ctx->threshold, ctx->truth, &ctx->score);
+}
+
+static int analyze(const char *path, const char *key_path, int print_bits) {
+  trace_map_t tm;
+  rsa_truth_t truth;
+  rsa_stream_t stream;
+  analyze_ctx_t ctx = {0};
+  int ret = 0;
+
+  if (key_path && rsa_truth_load(key_path, &truth) < 0)
+    return 1;
+  if (trace_map_open(&tm, path) < 0) {
+    if (key_path)
+      rsa_truth_free(&truth);
+    return 1;
+  }
+  ctx.threshold = tm.header.threshold;
+  ctx.truth = key_path ? &truth : NULL;
+  ctx.print_bits = print_bits;
+  ctx.score.ber_best = 1.0;
+  rsa_stream_init(&stream, RSA_STREAM_MAX_SLOTS);
+
+  double start = monotonic_seconds();
+  const trace_record_t *recs;
+  long n;
+  uint64_t chunks = 0;
+  while ((n = trace_map_next(&tm, &recs)) > 0) {
+    chunks++;
+    if (rsa_stream_feed(&stream, recs, n, analyze_segment, &ctx) < 0) {
+      fprintf(stderr, "Out of memory\n");
+      ret = 1;
+      break;
+    }
+  }
+  double elapsed = monotonic_seconds() - start;
+  if (n < 0)
+    ret = 1;
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  printf("\n=== ANALYSIS RESULTS ===\n");
+  printf("Trace: %s, %lu of %lu slots in %lu chunks (%s)\n", path, tm.slots,
+         tm.header.num_slots, chunks,
+         tm.header.encoding == TRACE_ENCODING_RLE ? "rle" : "raw");
+  printf("Operations: %lu, %lu decoded, %.1f bits each", ctx.segments,
+         ctx.decoded, ctx.decoded ? (double)ctx.bits / ctx.decoded : 0.0);
+  if (stream.dropped)
+    printf(", %lu over %d slots dropped", stream.dropped,
+           RSA_STREAM_MAX_SLOTS);
+  printf("\n");
+  if (ctx.truth)
+    printf("Bit error rate: %.4f mean, %.4f best over %lu operations\n",
+           ctx.score.scored ? ctx.score.ber_sum / ctx.score.scored : 1.0,
+           ctx.score.ber_best, ctx.score.scored);
+  printf("Read: %.1f MB in %.3f s (%.0f MB/s), peak RSS %ld KB, carry "
+         "buffer %zu slots\n",
+         tm.map_bytes / 1e6, elapsed,
+         elapsed > 0 ? tm.map_bytes / 1e6 / elapsed : 0.0, ru.ru_maxrss,
+         stream.cap);
+
+  rsa_stream_free(&stream);
+  trace_map_close(&tm);
+  if (key_path)
+    rsa_truth_free(&truth);
+  return ret;
+}
+
+static int index_trace(const char *path) {
+  trace_index_t idx;
+  int built;
+
+  double start = monotonic_seconds();
+  if (trace_index_open(path, &idx, &built) < 0)
+    return 1;
+  double elapsed = monotonic_seconds() - start;
+
+  char index_path[4096];
+  trace_index_path(path, index_path, sizeof(index_path));
+  printf("Index: %s, %s in %.3f s\n", index_path,
+         built ? "built" : "loaded", elapsed);
+  printf("Operations: %lu over %lu slots\n", idx.header.count,
+         idx.header.trace_slots);
+  if (idx.header.count) {
+    const trace_index_entry_t *first = &idx.entries[0];
+    const trace_index_entry_t *last = &idx.entries[idx.header.count - 1];
+    printf("First: slot %lu, tsc %lu; last: slot %lu, tsc %lu\n",
+           first->first_slot, first->tsc_begin, last->first_slot,
+           last->tsc_end);
+  }
+  trace_index_free(&idx);
+  return 0;
+}
+
+// Print operations [from, to) of the index, decoded and optionally scored
+static int show_operations(const char *path, trace_map_t *tm,
+                           const trace_index_t *idx, size_t from, size_t to,
+                           const char *key_path) {
+  rsa_truth_t truth;
+  int ret = 0;
+
+  if (key_path && rsa_truth_load(key_path, &truth) < 0)
+    return 1;
+  for (size_t i = from; i < to; i++) {
+    const trace_index_entry_t *e = &idx->entries[i];
+    trace_record_t *slots = malloc(e->slots * sizeof(*slots));
+    if (!slots || trace_index_read(tm, e, slots) < 0) {
+      fprintf(stderr, "%s: cannot read operation %zu\n", path, i);
+      free(slots);
+      ret = 1;
+      break;
+    }
+
+    char bits[RSA_MAX_BITS];
+    size_t len =
+        rsa_decode(slots, e->slots, tm->header.threshold, bits, sizeof(bits));
+    printf("Operation %zu: slots %lu-%lu, tsc %lu-%lu, byte %lu, %zu bits",
+           i, e->first_slot, e->first_slot + e->slots - 1, e->tsc_begin,
+           e->tsc_end, e->pos, len);
+    if (key_path) {
+      rsa_score_t score = {0};
+      score.ber_best = 1.0;
+      rsa_score_segment(slots, e->slots, tm->header.threshold, &truth, &score);
+      printf(", bit error rate %.4f", score.scored ? score.ber_best : 1.0);
+    }
+    printf("\n%.*s\n", (int)len, bits);
+    free(slots);
+  }
+  if (key_path)
+    rsa_truth_free(&truth);
+  return ret;
+}
+
+// Operation number N, or the operations overlapping [start, end) seconds
+// after the first slot
+static int seek_operations(const char *path, long op, double start,
+                           double end, const char *key_path) {
+  trace_index_t idx;
+  trace_map_t tm;
+  size_t from, to;
+
+  if (trace_index_open(path, &idx, NULL) < 0)
+    return 1;
+  if (trace_map_open(&tm, path) < 0) {
+    trace_index_free(&idx);
+    return 1;
+  }
+
+  if (op >= 0) {
+    if ((uint64_t)op >= idx.header.count) {
+      fprintf(stderr, "%s: %lu operations, no operation %ld\n", path,
+              idx.header.count, op);
+      trace_map_close(&tm);
+      trace_index_free(&idx);
+      return 1;
+    }
+    from = op;
+    to = op + 1;
+  } else {
+    const trace_record_t *recs;
+    uint64_t t0 = trace_map_next(&tm, &recs) > 0 ? recs[0].tsc : 0;
+    uint64_t hz = tm.header.tsc_hz;
+    from = trace_index_find_tsc(&idx, t0 + (uint64_t)(start * hz));
+    to = from;
+    while (to < idx.header.count &&
+           idx.entries[to].tsc_begin < t0 + (uint64_t)(end * hz))
+      to++;
+    printf("%zu operations between %.6f s and %.6f s\n", to - from, start,
+           end);
+  }
+
+  int ret = show_operations(path, &tm, &idx, from, to, key_path);
+  trace_map_close(&tm);
+  trace_index_free(&idx);
+  return ret;
+}
+
+// One row of the --score CSV
+typedef struct {
+  const char *path;
+  char key_path[4096];
+  int ok;
+  const char *engine;
+  uint64_t slot_cycles;
+  uint32_t threshold;
+  uint64_t slots;
+  uint64_t missed;
+  uint64_t overrun;
+  uint64_t operations;
+  rsa_score_t score;
+  double seconds;
+  int worker;
+} score_result_t;
+
+typedef struct {
+  char *const *paths;
+  const char *key_path; // NULL: key.txt next to each trace
+  score_result_t *results;
+} batch_t;
+
+typedef struct {
+  int threshold;
+  const rsa_truth_t *truth;
+  uint64_t operations;
+  rsa_score_t *score;
+} score_ctx_t;
+
+static void score_segment(const trace_record_t *slots, size_t n,
+                          uint64_t first_slot, void *arg) {
+  score_ctx_t *ctx = arg;
+
+  (void)first_slot;
+  ctx->operations++;
+  rsa_score_segment(slots, n, ctx->threshold, ctx->truth, ctx->score);
+}
+
+// The key bench_driver writes beside its trace
+static void default_key_path(const char *trace_path, char *path, size_t size) {
+  const char *slash = strrchr(trace_path, '/');
+  if (slash)
+    snprintf(path, size, "%.*s/key.txt", (int)(slash - trace_path), trace_path);
+  else
+    snprintf(path, size, "key.txt");
+}
+
+// Workpool task: stream one trace and score every operation in it
+static void score_file(size_t task, int worker, void *arg) {
+  batch_t *batch = arg;
+  score_result_t *r = &batch->results[task];
+  trace_map_t tm;
+  rsa_truth_t truth;
+  rsa_stream_t stream;
+
+  double start = monotonic_seconds();
+  r->path = batch->paths[task];
+  r->worker = worker;
+  r->score.ber_best = 1.0;
+  if (batch->key_path)
+    snprintf(r->key_path, sizeof(r->key_path), "%s", batch->key_path);
+  else
+    default_key_path(r->path, r->key_path, sizeof(r->key_path));
+  if (rsa_truth_load(r->key_path, &truth) < 0)
+    return;
+  if (trace_map_open(&tm, r->path) < 0) {
+    rsa_truth_free(&truth);
+    return;
+  }
+  r->engine = trace_engine_name(tm.header.engine);
+  r->slot_cycles = tm.header.slot_cycles;
+  r->threshold = tm.header.threshold;
+
+  score_ctx_t ctx = {(int)tm.header.threshold, &truth, 0, &r->score};
+  rsa_stream_init(&stream, RSA_STREAM_MAX_SLOTS);
+  const trace_record_t *recs;
+  long n;
+  r->ok = 1;
+  while ((n = trace_map_next(&tm, &recs)) > 0) {
+    for (long i = 0; i < n; i++) {
+      r->missed += (recs[i].flags & TRACE_SLOT_MISSED) != 0;
+      r->overrun += (recs[i].flags & TRACE_SLOT_OVERRUN) != 0;
+    }
+    if (rsa_stream_feed(&stream, recs, n, score_segment, &ctx) < 0) {
+      fprintf(stderr, "%s: out of memory\n", r->path);
+      r->ok = 0;
+      break;
+    }
+  }
+  if (n < 0)
+    r->ok = 0;
+  r->slots = tm.slots;
+  r->operations = ctx.operations;
+  rsa_stream_free(&stream);
+  trace_map_close(&tm);
+  rsa_truth_free(&truth);
+  r->seconds = monotonic_seconds() - start;
+}
+
+// RFC 4180: a field holding a separator, quote or line break is quoted,
+// with its quotes doubled
+static void csv_field(FILE *f, const char *s) {
+  if (!strpbrk(s, ",\"\r\n")) {
+    fputs(s, f);
+    return;
+  }
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"')
+      fputc('"', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+static int write_scores(const char *csv_path, const score_result_t *results,
+                        size_t count) {
+  FILE *f = fopen(csv_path, "w");
+  if (!f) {
+    perror(csv_path);
+    return -1;
+  }
+  fprintf(f, "file,key,status,engine,slot_cycles,threshold,slots,"
+             "missed_slots,overrun_slots,operations,scored,bits,"
+             "bit_error_rate,best_bit_error_rate,seconds,worker\n");
+  // Input order, whichever worker scored the file
+  for (size_t i = 0; i < count; i++) {
+    const score_result_t *r = &results[i];
+    csv_field(f, r->path);
+    fputc(',', f);
+    csv_field(f, r->key_path);
+    if (!r->ok) {
+      fprintf(f, ",error,,,,,,,,,,,,%.6f,%d\n", r->seconds, r->worker);
+      continue;
+    }
+    fprintf(f, ",ok,%s,%lu,%u,%lu,%lu,%lu,%lu,%lu,%lu,%.6f,%.6f,%.6f,%d\n",
+            r->engine, r->slot_cycles, r->threshold,
+            r->slots, r->missed, r->overrun, r->operations, r->score.scored,
+            r->score.bits,
+            r->score.scored ? r->score.ber_sum / r->score.scored : 1.0,
+            r->score.ber_best, r->seconds, r->worker);
+  }
+  if (fclose(f) != 0) {
+    fprintf(stderr, "Failed to write %s\n", csv_path);
+    return -1;
+  }
+  return 0;
+}
+
+// Score every trace on a work-stealing pool and merge one CSV
+static int score_batch(char *const *paths, size_t count, const char *key_path,
+                       int threads, const char *csv_path) {
+  batch_t batch = {paths, key_path, calloc(count, sizeof(score_result_t))};
+  workpool_stats_t *stats = calloc(threads, sizeof(*stats));
+  if (!batch.results || !stats) {
+    fprintf(stderr, "Out of memory\n");
+    free(batch.results);
+    free(stats);
+    return 1;
+  }
+
+  double start = monotonic_seconds();
+  if (workpool_run(count, threads, score_file, &batch, stats) < 0) {
+    fprintf(stderr, "Failed to start scoring threads\n");
+    free(batch.results);
+    free(stats);
+    return 1;
+  }
+  double wall = monotonic_seconds() - start;
+  int ret = write_scores(csv_path, batch.results, count) < 0;
+
+  size_t failed = 0;
+  uint64_t slots = 0;
+  const score_result_t *best = NULL;
+  for (size_t i = 0; i < count; i++) {
+    const score_result_t *r = &batch.results[i];
+    if (!r->ok) {
+      failed++;
+      continue;
+    }
+    slots += r->slots;
+    if (r->score.scored &&
+        (!best || r->score.ber_sum / r->score.scored <
+                      best->score.ber_sum / best->score.scored))
+      best = r;
+  }
+  double cpu = 0;
+  uint64_t stolen = 0;
+  for (int t = 0; t < threads; t++) {
+    cpu += stats[t].cpu;
+    stolen += stats[t].stolen;
+  }
+
+  printf("\n=== BATCH SCORING RESULTS ===\n");
+  printf("Files: %zu scored, %zu failed, %lu slots\n", count - failed, failed,
+         slots);
+  printf("Wall time: %.3f s on %d threads (%.1f files/s, %.1f M slots/s)\n",
+         wall, threads, wall > 0 ? count / wall : 0.0,
+         wall > 0 ? slots / wall / 1e6 : 0.0);
+  // Scoring CPU time over wall time: how many cores were kept busy on
+  // average. It is not a speedup over a serial run, which would also pay
+  // for the cache and memory bandwidth the workers share
+  printf("CPU utilization: %.2f cores (%.3f CPU s of scoring), %lu files "
+         "stolen\n",
+         wall > 0 ? cpu / wall : 0.0, cpu, stolen);
+  for (int t = 0; t < threads; t++)
+    printf("  Worker %d: %lu files, %lu stolen, %.3f CPU s\n", t,
+           stats[t].tasks, stats[t].stolen, stats[t].cpu);
+  if (best)
+    printf("Best: %s, bit error rate %.4f mean over %lu operations\n",
+           best->path, best->score.ber_sum / best->score.scored,
+           best->score.scored);
+  printf("Scores: %s\n", csv_path);
+
+  free(batch.results);
+  free(stats);
+  return ret || failed;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s --info FILE\n"
+          "       %s --compress IN OUT [--idle-floor N]\n"
+          "       %s --decompress IN OUT\n"
+          "       %s --bench FILE [--idle-floor N]\n"
+          "       %s --analyze FILE [--key KEY] [--bits]\n"
+          "       %s --index FILE\n"
+          "       %s --op N FILE [--key KEY]\n"
+          "       %s --time START[:END] FILE [--key KEY]\n"
+          "       %s --score [--key KEY] [--jobs N] [--csv OUT] FILE...\n",
+          prog, prog, prog, prog, prog, prog, prog, prog, prog);
+  fprintf(stderr, "  --info FILE        print the trace header\n");
+  fprintf(stderr, "  --compress IN OUT  rewrite IN with RLE storage\n");
+  fprintf(stderr, "  --decompress IN OUT  rewrite IN with raw records\n");
+  fprintf(stderr, "  --bench FILE       measure the RLE compression ratio and "
+                  "encode/decode speed\n");
+  fprintf(stderr, "  --idle-floor N     store slots with every latency at "
+                  "or above N as idle, lossy\n"
+                  "                     (default: 0, every record stored "
+                  "exactly)\n");
+  fprintf(stderr, "  --analyze FILE     decode every victim operation, "
+                  "streaming from a mapping\n");
+  fprintf(stderr, "  --key KEY          score --analyze against a "
+                  "victim_rsa --key-out file\n");
+  fprintf(stderr, "  --bits             print the bits of every "
+                  "operation\n");
+  fprintf(stderr, "  --index FILE       build FILE.idx, or check it is "
+                  "current\n");
+  fprintf(stderr, "  --op N             decode operation N through the "
+                  "index\n");
+  fprintf(stderr, "  --time START[:END] decode the operations in a window, "
+                  "seconds after the\n"
+                  "                     first slot (END defaults to "
+                  "START)\n");
+  fprintf(stderr, "  --score FILE...    score many traces in parallel into "
+                  "one CSV; each is\n"
+                  "                     checked against KEY, or key.txt in "
+                  "its directory\n");
+  fprintf(stderr, "  --jobs N           --score worker threads (default: "
+                  "online CPUs)\n");
+  fprintf(stderr, "  --csv OUT          --score output (default: "
+                  "scores.csv)\n");
+}
+
+int main(int argc, char *argv[]) {
+  enum {
+    MODE_NONE,
+    MODE_INFO,
+    MODE_COMPRESS,
+    MODE_DECOMPRESS,
+    MODE_BENCH,
+    MODE_ANALYZE,
+    MODE_INDEX,
+    MODE_SEEK,
+    MODE_SCORE
+  };
+  int mode = MODE_NONE;
+  long idle_floor = 0;
+  const char *key_path = NULL;
+  int print_bits = 0;
+  long op = -1;
+  double start = 0, end = 0;
+  char *colon;
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *csv_path = "scores.csv";
+
+  static const struct option long_options[] = {
+      {"info", no_argument, NULL, 'i'},
+      {"compress", no_argument, NULL, 'c'},
+      {"decompress", no_argument, NULL, 'd'},
+      {"bench", no_argument, NULL, 'b'},
+      {"idle-floor", required_argument, NULL, 'f'},
+      {"analyze", no_argument, NULL, 'a'},
+      {"key", required_argument, NULL, 'k'},
+      {"bits", no_argument, NULL, 'B'},
+      {"index", no_argument, NULL, 'x'},
+      {"op", required_argument, NULL, 'o'},
+      {"time", required_argument, NULL, 't'},
+      {"score", no_argument, NULL, 's'},
+      {"jobs", required_argument, NULL, 'j'},
+      {"csv", required_argument, NULL, 'C'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "icdbf:ak:Bxo:t:sj:C:h", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+    case 'i':
+      mode = MODE_INFO;
+      break;
+    case 'c':
+      mode = MODE_COMPRESS;
+      break;
+    case 'd':
+      mode = MODE_DECOMPRESS;
+      break;
+    case 'b':
+      mode = MODE_BENCH;
+      break;
+    case 'a':
+      mode = MODE_ANALYZE;
+      break;
+    case 'k':
+      key_path = optarg;
+      break;
+    case 'B':
+      print_bits = 1;
+      break;
+    case 'x':
+      mode = MODE_INDEX;
+      break;
+    case 'o':
+      mode = MODE_SEEK;
+      op = strtol(optarg, NULL, 0);
+      if (op < 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 't':
+      mode = MODE_SEEK;
+      op = -1;
+      start = end = strtod(optarg, &colon);
+      if (*colon == ':')
+        end = strtod(colon + 1, NULL);
+      if (start < 0 || end < start) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 's':
+      mode = MODE_SCORE;
+      break;
+    case 'j':
+      jobs = strtol(optarg, NULL, 0);
+      if (jobs < 1 || jobs > 1024) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'C':
+      csv_path = optarg;
+      break;
+    case 'f':
+      idle_floor = strtol(optarg, NULL, 0);
+      if (idle_floor < 0 || idle_floor > 0xffff) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  int files = argc - optind;
+  switch (mode) {
+  case MODE_INFO:
+    if (files == 1)
+      return print_info(argv[optind]);
+    break;
+  case MODE_COMPRESS:
+  case MODE_DECOMPRESS:
+    if (files == 2)
+      return convert(argv[optind], argv[optind + 1], mode == MODE_COMPRESS,
+                     idle_floor);
+    break;
+  case MODE_BENCH:
+    if (files == 1)
+      return bench(argv[optind], idle_floor);
+    break;
+  case MODE_ANALYZE:
+    if (files == 1)
+      return analyze(argv[optind], key_path, print_bits);
+    break;
+  case MODE_INDEX:
+    if (files == 1)
+      return index_trace(argv[optind]);
+    break;
+  case MODE_SEEK:
+    if (files == 1)
+      return seek_operations(argv[optind], op, start, end, key_path);
+    break;
+  case MODE_SCORE:
+    if (files >= 1)
+      return score_batch(argv + optind, files, key_path,
+                         jobs < 1 ? 1 : (int)jobs, csv_path);
+    break;
+  }
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,63 @@
+#include "tvla.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static welford_t *acc_at(const tvla_t *t, int cls, int slot, int line) {
+  return &t->acc[((size_t)cls * t->num_slots + slot) * t->num_lines + line];
+}
+
+int tvla_init(tvla_t *t, int num_slots, int num_lines) {
+  t->num_slots = num_slots;
+  t->num_lines = num_lines;
+  t->traces[0] = t->traces[1] = 0;
+  t->acc = calloc((size_t)2 * num_slots * num_lines, sizeof(welford_t));
+  return t->acc ? 0 : -1;
+}
+
+void tvla_free(tvla_t *t) {
+  free(t->acc);
+  t->acc = NULL;
+}
+
+void tvla_add_trace(tvla_t *t, int cls, const uint8_t *samples) {
+  for (int s = 0; s < t->num_slots; s++) {
+    for (int l = 0; l < t->num_lines; l++) {
+      welford_add(acc_at(t, cls, s, l), samples[s * t->num_lines + l]);
+    }
+  }
+  t->traces[cls]++;
+}
+
+double tvla_welch_t(const tvla_t *t, int slot, int line) {
+  const welford_t *a = acc_at(t, 0, slot, line);
+  const welford_t *b = acc_at(t, 1, slot, line);
+
+  if (a->n < 2 || b->n < 2)
+    return 0.0;
+
+  double se = welford_variance(a) / a->n + welford_variance(b) / b->n;
+  // Both classes constant: identical means carry no evidence, differing
+  // means are a deterministic leak.
+  if (se == 0.0)
+    return a->mean == b->mean ? 0.0 : INFINITY;
+
+  return (a->mean - b->mean) / sqrt(se);
+}
+
+int tvla_line_result(const tvla_t *t, int line, tvla_line_result_t *res) {
+  res->max_t = 0.0;
+  res->max_slot = 0;
+  res->leaky_slots = 0;
+
+  for (int s = 0; s < t->num_slots; s++) {
+    double abs_t = fabs(tvla_welch_t(t, s, line));
+    if (abs_t > res->max_t) {
+      res->max_t = abs_t;
+      res->max_slot = s;
+    }
+    if (abs_t > TVLA_THRESHOLD)
+      res->leaky_slots++;
+  }
+  return res->leaky_slots > 0;
+}
@@ -0,0 +1,58 @@
+#ifndef TVLA_H
+#define TVLA_H
+
+#include <stdint.h>
+
+// Fixed-vs-random leakage assessment (TVLA).
+//
+// Every trace is a window of num_slots slots aligned on the start of one
+// victim operation, with one sample per monitored line. Samples are folded
+// into per-class, per-slot, per-line running moments (Welford), so memory
+// stays at num_slots * num_lines * 2 accumulators no matter how many traces
+// are processed.
+
+#define TVLA_THRESHOLD 4.5
+
+typedef struct {
+  uint64_t n;
+  double mean;
+  double m2;
+} welford_t;
+
+typedef struct {
+  int num_slots;
+  int num_lines;
+  uint64_t traces[2];
+  welford_t *acc; // [class][slot][line]
+} tvla_t;
+
+typedef struct {
+  double max_t; // largest |t| over all slots
+  int max_slot;
+  int leaky_slots; // slots with |t| above TVLA_THRESHOLD
+} tvla_line_result_t;
+
+static inline void welford_add(welford_t *w, double x) {
+  w->n++;
+  double delta = x - w->mean;
+  w->mean += delta / w->n;
+  w->m2 += delta * (x - w->mean);
+}
+
+static inline double welford_variance(const welford_t *w) {
+  return w->n > 1 ? w->m2 / (w->n - 1) : 0.0;
+}
+
+int tvla_init(tvla_t *t, int num_slots, int num_lines);
+void tvla_free(tvla_t *t);
+
+// Fold one complete trace of num_slots * num_lines samples, slot-major.
+void tvla_add_trace(tvla_t *t, int cls, const uint8_t *samples);
+
+// Welch's t-statistic of the fixed class against the random class.
+double tvla_welch_t(const tvla_t *t, int slot, int line);
+
+// Summarise one line; returns nonzero if any slot exceeds TVLA_THRESHOLD.
+int tvla_line_result(const tvla_t *t, int line, tvla_line_result_t *res);
+
+#endif
@@ -4,7 +4,19 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <signal.h>
+#include <getopt.h>
 #include "gcrypt.h"
+#include "harness.h"
+
+#define BLOCK_SIZE 16
+#define MAX_PLAINTEXTS 65536
+#define DEFAULT_ARENA_MB 64
+#define HW_FEATURE "padlock-aes" // the only hardware AES path in libgcrypt 1.4.6
+
+typedef enum { IMPL_AUTO, IMPL_TABLE, IMPL_HW } aes_impl_t;
+
+static const char *mode_names[] = {"ecb", "cbc", "ctr"};
+static const int mode_ids[] = {GCRY_CIPHER_MODE_ECB, GCRY_CIPHER_MODE_CBC, GCRY_CIPHER_MODE_CTR};
 
 volatile int running = 1;
 
@@ -12,14 +24,294 @@ void signal_handler(int sig) {
     running = 0;
 }
 
-int main() {
+// Read one 16-byte block per line, as 32 hex digits. Blank lines and lines
+// starting with '#' are skipped.
+static int load_plaintexts(const char *path, unsigned char (**blocks)[BLOCK_SIZE]) {
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int n = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    *blocks = malloc(MAX_PLAINTEXTS * BLOCK_SIZE);
+    if (!*blocks) {
+        fclose(f);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) && n < MAX_PLAINTEXTS) {
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        for (int i = 0; i < BLOCK_SIZE; i++) {
+            unsigned int byte;
+            if (sscanf(p + 2 * i, "%2x", &byte) != 1) {
+                fprintf(stderr, "%s: bad plaintext line: %s", path, line);
+                fclose(f);
+                free(*blocks);
+                return -1;
+            }
+            (*blocks)[n][i] = byte;
+        }
+        n++;
+    }
+    fclose(f);
+
+    if (n == 0) {
+        fprintf(stderr, "%s: no plaintexts\n", path);
+        free(*blocks);
+        return -1;
+    }
+    return n;
+}
+
+// Check the library's hardware feature list (GCRYCTL_PRINT_CONFIG "hwflist:")
+static int library_has_hwf(const char *feature) {
+    FILE *f = tmpfile();
+    char line[512];
+    int found = 0;
+
+    if (!f) {
+        return 0;
+    }
+    gcry_control(GCRYCTL_PRINT_CONFIG, f);
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "hwflist:", 8) == 0) {
+            for (char *tok = strtok(line + 8, ":\n"); tok; tok = strtok(NULL, ":\n")) {
+                found |= strcmp(tok, feature) == 0;
+            }
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Reset the chaining state so every operation starts from the same IV or
+// counter, as the plaintext class assumes
+static gcry_error_t reset_chaining(gcry_cipher_hd_t handle, int mode) {
+    static const unsigned char zero[BLOCK_SIZE];
+
+    if (mode == GCRY_CIPHER_MODE_CBC) {
+        return gcry_cipher_setiv(handle, zero, BLOCK_SIZE);
+    }
+    if (mode == GCRY_CIPHER_MODE_CTR) {
+        return gcry_cipher_setctr(handle, zero, BLOCK_SIZE);
+    }
+    return 0;
+}
+
+typedef struct {
+    gcry_cipher_hd_t handle;
+    int mode; // GCRY_CIPHER_MODE_*
+    size_t buffer_size;
+    harness_status_t *status;
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t cycles; // spent inside gcry_cipher_encrypt
+} victim_t;
+
+// Encrypt one buffer in place as one published operation. The first byte is
+// the operation class, so an attacker can condition table line hits on the
+// input driving the first round.
+static gcry_error_t encrypt_op(victim_t *v, unsigned char *buf) {
+    gcry_error_t err = reset_chaining(v->handle, v->mode);
+    if (err) {
+        fprintf(stderr, "Failed to set IV: %s\n", gcry_strerror(err));
+        return err;
+    }
+
+    harness_op_begin(v->status, buf[0]);
+    uint64_t start = harness_rdtsc();
+    err = gcry_cipher_encrypt(v->handle, buf, v->buffer_size, NULL, 0);
+    v->cycles += harness_rdtsc() - start;
+    harness_op_end(v->status);
+    if (err) {
+        fprintf(stderr, "Encryption failed: %s\n", gcry_strerror(err));
+        return err;
+    }
+
+    v->ops++;
+    v->bytes += v->buffer_size;
+    // In double: bytes * tsc_hz overflows 64 bits after a few GB
+    v->status->throughput = (double)v->bytes * v->status->tsc_hz / v->cycles;
+    return 0;
+}
+
+// Original loop: encrypt the next plaintext, decrypt it again, then sleep
+static void run_blocks(victim_t *v, unsigned char (*plaintexts)[BLOCK_SIZE],
+                       int num_plaintexts, char *ciphertext, char *decrypted) {
+    while (running) {
+        const unsigned char *plaintext = plaintexts[v->ops % num_plaintexts];
+        for (size_t off = 0; off < v->buffer_size; off += BLOCK_SIZE) {
+            memcpy(ciphertext + off, plaintext, BLOCK_SIZE);
+        }
+
+        if (encrypt_op(v, (unsigned char *)ciphertext)) {
+            break;
+        }
+
+        memcpy(decrypted, ciphertext, v->buffer_size);
+        reset_chaining(v->handle, v->mode);
+        gcry_error_t err = gcry_cipher_decrypt(v->handle, decrypted, v->buffer_size, NULL, 0);
+        if (err) {
+            fprintf(stderr, "Decryption failed: %s\n", gcry_strerror(err));
+            break;
+        }
+
+        if (v->ops % 10000 == 0) {
+            printf("Victim: Completed %lu encryption/decryption cycles\n", v->ops);
+        }
+
+        usleep(100);
+    }
+}
+
+// Streaming mode: encrypt consecutive buffer-sized slices of a pre-faulted
+// arena in place, back to back, with nothing but the cipher between calls
+static void run_stream(victim_t *v, unsigned char *arena, size_t arena_size) {
+    size_t slices = arena_size / v->buffer_size;
+    uint64_t report_at = harness_rdtsc() + v->status->tsc_hz;
+    uint64_t last_bytes = 0;
+    uint64_t last_cycles = 0;
+
+    while (running) {
+        if (encrypt_op(v, arena + (v->ops % slices) * v->buffer_size)) {
+            break;
+        }
+
+        if (harness_rdtsc() >= report_at) {
+            uint64_t bytes = v->bytes - last_bytes;
+            uint64_t cycles = v->cycles - last_cycles;
+            printf("Victim: %.2f cycles/byte, %.1f MB/s\n", (double)cycles / bytes,
+                   bytes * (double)v->status->tsc_hz / cycles / 1e6);
+            last_bytes = v->bytes;
+            last_cycles = v->cycles;
+            report_at += v->status->tsc_hz;
+        }
+    }
+}
+
+// Parse a byte count with an optional K, M or G suffix
+static size_t parse_size(const char *arg) {
+    char *end;
+    size_t n = strtoul(arg, &end, 0);
+
+    switch (*end) {
+    case 'G':
+    case 'g':
+        n <<= 10;
+        // fall through
+    case 'M':
+    case 'm':
+        n <<= 10;
+        // fall through
+    case 'K':
+    case 'k':
+        n <<= 10;
+    }
+    return n;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--plaintexts FILE] [--key-bits N] [--mode MODE] [--buffer N]\n"
+                    "          [--impl table|hw|auto] [--stream] [--arena N] [--status NAME]\n", prog);
+    fprintf(stderr, "  --plaintexts FILE  encrypt these blocks in turn, one 32-digit hex block\n");
+    fprintf(stderr, "                     per line (default: a fixed plaintext)\n");
+    fprintf(stderr, "  --key-bits N       AES key size: 128, 192 or 256 (default: 128)\n");
+    fprintf(stderr, "  --mode MODE        ecb, cbc or ctr (default: ecb)\n");
+    fprintf(stderr, "  --buffer N         bytes per encryption, a multiple of 16; K and M\n"
+                    "                     suffixes accepted (default: 16)\n");
+    fprintf(stderr, "  --impl WHICH       require the table path, the hardware path (" HW_FEATURE ",\n"
+                    "                     AES-128 only) or take what the library picks (default)\n");
+    fprintf(stderr, "  --stream           encrypt arena slices in place back to back, without\n"
+                    "                     copies, decryption or sleeps\n");
+    fprintf(stderr, "  --arena N          streaming arena size (default: %dM or one buffer)\n",
+            DEFAULT_ARENA_MB);
+    fprintf(stderr, "  --status NAME      status page name (default: aes)\n");
+}
+
+int main(int argc, char *argv[]) {
     gcry_error_t err;
     gcry_cipher_hd_t handle;
-    char key[16] = "0123456789ABCDEF";
-    char plaintext[16] = "Hello, World!!!!";
-    char ciphertext[16];
-    char decrypted[16];
-    size_t len = 16;
+    char key[32] = "0123456789ABCDEF0123456789ABCDEF";
+    int key_bits = 128;
+    int mode = 0;
+    size_t buffer_size = BLOCK_SIZE;
+    aes_impl_t impl = IMPL_AUTO;
+    unsigned char default_plaintext[1][BLOCK_SIZE] = {"Hello, World!!!!"};
+    unsigned char (*plaintexts)[BLOCK_SIZE] = default_plaintext;
+    int num_plaintexts = 1;
+    const char *status_name = "aes";
+    char *ciphertext;
+    char *decrypted;
+    int stream = 0;
+    size_t arena_size = (size_t)DEFAULT_ARENA_MB << 20;
+    unsigned char *arena = NULL;
+
+    static const struct option long_options[] = {
+        {"plaintexts", required_argument, NULL, 'p'},
+        {"key-bits", required_argument, NULL, 'k'},
+        {"mode", required_argument, NULL, 'm'},
+        {"buffer", required_argument, NULL, 'b'},
+        {"impl", required_argument, NULL, 'i'},
+        {"stream", no_argument, NULL, 'S'},
+        {"arena", required_argument, NULL, 'a'},
+        {"status", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:k:m:b:i:Sa:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'p':
+            num_plaintexts = load_plaintexts(optarg, &plaintexts);
+            if (num_plaintexts < 0) {
+                return 1;
+            }
+            break;
+        case 'k':
+            key_bits = atoi(optarg);
+            break;
+        case 'm':
+            for (mode = 0; mode < 3 && strcmp(optarg, mode_names[mode]) != 0; mode++) {
+            }
+            break;
+        case 'b':
+            buffer_size = parse_size(optarg);
+            break;
+        case 'S':
+            stream = 1;
+            break;
+        case 'a':
+            arena_size = parse_size(optarg);
+            break;
+        case 'i':
+            impl = strcmp(optarg, "table") == 0 ? IMPL_TABLE
+                   : strcmp(optarg, "hw") == 0  ? IMPL_HW
+                   : strcmp(optarg, "auto") == 0 ? IMPL_AUTO
+                                                 : -1;
+            break;
+        case 's':
+            status_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if ((key_bits != 128 && key_bits != 192 && key_bits != 256) || mode == 3 ||
+        buffer_size == 0 || buffer_size % BLOCK_SIZE != 0 || (int)impl < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (arena_size < buffer_size) {
+        arena_size = buffer_size;
+    }
+    arena_size -= arena_size % buffer_size;
 
     printf("Victim process starting (PID: %d)\n", getpid());
 
@@ -34,48 +326,98 @@ int main() {
     gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
     gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
 
-    err = gcry_cipher_open(&handle, GCRY_CIPHER_AES128, GCRY_CIPHER_MODE_ECB, 0);
+    // 1.4.6 has no switch for the AES path: setkey picks PadLock for 128-bit
+    // keys when the CPU has it and the T-tables otherwise
+    int hw_path = key_bits == 128 && library_has_hwf(HW_FEATURE);
+    if (impl == IMPL_TABLE && hw_path) {
+        fprintf(stderr, "The library uses " HW_FEATURE " for AES-128 here; "
+                        "use --key-bits 192 or 256 for the table path\n");
+        return 1;
+    }
+    if (impl == IMPL_HW && !hw_path) {
+        fprintf(stderr, "No hardware AES path: this libgcrypt only accelerates "
+                        "AES-128 with " HW_FEATURE " (no AES-NI)\n");
+        return 1;
+    }
+    const char *impl_name = hw_path ? HW_FEATURE : "table";
+
+    int algo = key_bits == 128 ? GCRY_CIPHER_AES128
+               : key_bits == 192 ? GCRY_CIPHER_AES192
+                                 : GCRY_CIPHER_AES256;
+    err = gcry_cipher_open(&handle, algo, mode_ids[mode], 0);
     if (err) {
         fprintf(stderr, "Failed to create cipher handle: %s\n", gcry_strerror(err));
         return 1;
     }
 
-    err = gcry_cipher_setkey(handle, key, 16);
+    err = gcry_cipher_setkey(handle, key, key_bits / 8);
     if (err) {
         fprintf(stderr, "Failed to set key: %s\n", gcry_strerror(err));
         gcry_cipher_close(handle);
         return 1;
     }
 
-    printf("Victim: Starting AES encryption loop...\n");
-    printf("Victim: Press Ctrl+C to stop\n");
-
-    int iteration = 0;
-    while (running) {
-        memcpy(ciphertext, plaintext, len);
-
-        err = gcry_cipher_encrypt(handle, ciphertext, len, NULL, 0);
-        if (err) {
-            fprintf(stderr, "Encryption failed: %s\n", gcry_strerror(err));
-            break;
+    ciphertext = malloc(buffer_size);
+    decrypted = malloc(buffer_size);
+    if (stream) {
+        // Page aligned and faulted in up front, so no page faults land
+        // inside the timed encryptions
+        arena = mmap(NULL, arena_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (arena == MAP_FAILED) {
+            perror("mmap arena");
+            gcry_cipher_close(handle);
+            return 1;
         }
-
-        memcpy(decrypted, ciphertext, len);
-        err = gcry_cipher_decrypt(handle, decrypted, len, NULL, 0);
-        if (err) {
-            fprintf(stderr, "Decryption failed: %s\n", gcry_strerror(err));
-            break;
+        for (size_t off = 0; off < arena_size; off += BLOCK_SIZE) {
+            memcpy(arena + off, plaintexts[(off / BLOCK_SIZE) % num_plaintexts], BLOCK_SIZE);
         }
+    }
+    harness_status_t *status = harness_status_create(status_name);
+    if (!ciphertext || !decrypted || !status) {
+        gcry_cipher_close(handle);
+        return 1;
+    }
+    snprintf(status->cipher_desc, sizeof(status->cipher_desc), "%s AES-%d %s, %zu B/op",
+             impl_name, key_bits, mode_names[mode], buffer_size);
+    status->tsc_hz = harness_tsc_hz();
 
-        iteration++;
-        if (iteration % 10000 == 0) {
-            printf("Victim: Completed %d encryption/decryption cycles\n", iteration);
-        }
+    printf("Victim: %s\n", status->cipher_desc);
+    if (stream) {
+        printf("Victim: Streaming over a %zu byte arena at %p\n", arena_size, (void *)arena);
+    } else {
+        printf("Victim: Encrypting %d plaintext block(s) in turn\n", num_plaintexts);
+    }
+    printf("Victim: Starting AES encryption loop...\n");
+    printf("Victim: Press Ctrl+C to stop\n");
+    status->ready = 1;
 
-        usleep(100);
+    victim_t victim = {handle, mode_ids[mode], buffer_size, status, 0, 0, 0};
+    if (stream) {
+        run_stream(&victim, arena, arena_size);
+    } else {
+        run_blocks(&victim, plaintexts, num_plaintexts, ciphertext, decrypted);
+    }
+
+    printf("Victim: Exiting after %lu encryptions\n", victim.ops);
+    printf("\n=== AES VICTIM RESULTS ===\n");
+    printf("Cipher: %s\n", status->cipher_desc);
+    printf("Encrypted: %lu bytes in %lu cycles\n", victim.bytes, victim.cycles);
+    if (victim.bytes > 0) {
+        printf("Cost: %.2f cycles/byte\n", (double)victim.cycles / victim.bytes);
     }
+    printf("Throughput: %.1f MB/s (encryption calls only)\n", status->throughput / 1e6);
 
+    status->finished = 1;
+    harness_status_close(status);
     gcry_cipher_close(handle);
-    printf("Victim: Exiting after %d iterations\n", iteration);
+    free(ciphertext);
+    free(decrypted);
+    if (arena) {
+        munmap(arena, arena_size);
+    }
+    if (plaintexts != default_plaintext) {
+        free(plaintexts);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -6,7 +6,15 @@
 #include <sys/mman.h>
 #include <signal.h>
 #include <time.h>
+#include <getopt.h>
 #include "gcrypt.h"
+#include "harness.h"
+
+// Pool of alternative keypairs used for the random class of a key TVLA run.
+// Generating a fresh 1024-bit key per decryption would dominate the run.
+#define TVLA_KEY_POOL 4
+
+enum tvla_mode { TVLA_OFF, TVLA_INPUT, TVLA_KEY };
 
 volatile int running = 1;
 
@@ -14,22 +22,165 @@ void signal_handler(int sig) {
     running = 0;
 }
 
-int main() {
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--tvla input|key] [--key-out FILE] [--status NAME]\n", prog);
+    fprintf(stderr, "  --tvla input   alternate fixed and random ciphertexts\n");
+    fprintf(stderr, "  --tvla key     alternate the fixed key and a pool of random keys\n");
+    fprintf(stderr, "  --key-out FILE write the CRT exponents as ground truth\n");
+    fprintf(stderr, "  --status NAME  status page name (default: rsa)\n");
+}
+
+static int generate_keypair(gcry_sexp_t *pubkey, gcry_sexp_t *privkey) {
+    gcry_sexp_t params, keypair;
+    gcry_error_t err;
+
+    err = gcry_sexp_build(&params, NULL, "(genkey (rsa (nbits 4:1024)))");
+    if (err) {
+        fprintf(stderr, "Failed to build RSA genkey s-expression: %s\n", gcry_strerror(err));
+        return -1;
+    }
+
+    err = gcry_pk_genkey(&keypair, params);
+    gcry_sexp_release(params);
+    if (err) {
+        fprintf(stderr, "Failed to generate RSA keypair: %s\n", gcry_strerror(err));
+        return -1;
+    }
+
+    *pubkey = gcry_sexp_find_token(keypair, "public-key", 0);
+    *privkey = gcry_sexp_find_token(keypair, "private-key", 0);
+    gcry_sexp_release(keypair);
+
+    if (!*pubkey || !*privkey) {
+        fprintf(stderr, "Failed to extract RSA keys\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void write_bits(FILE *out, const char *label, gcry_mpi_t value) {
+    fprintf(out, "%s ", label);
+    for (int i = gcry_mpi_get_nbits(value) - 1; i >= 0; i--) {
+        fputc(gcry_mpi_test_bit(value, i) ? '1' : '0', out);
+    }
+    fputc('\n', out);
+}
+
+// Write the exponents actually used by decryption: libgcrypt decrypts with
+// CRT, exponentiating by d mod (p-1) and then by d mod (q-1).
+static int write_key_bits(const char *path, gcry_sexp_t privkey) {
+    gcry_mpi_t d, p, q, dp, dq;
+    gcry_sexp_t token;
+    const char *names[] = {"d", "p", "q"};
+    gcry_mpi_t *values[] = {&d, &p, &q};
+
+    for (int i = 0; i < 3; i++) {
+        token = gcry_sexp_find_token(privkey, names[i], 0);
+        if (!token) {
+            fprintf(stderr, "Private key has no '%s'\n", names[i]);
+            return -1;
+        }
+        *values[i] = gcry_sexp_nth_mpi(token, 1, GCRYMPI_FMT_USG);
+        gcry_sexp_release(token);
+    }
+
+    dp = gcry_mpi_new(0);
+    dq = gcry_mpi_new(0);
+    gcry_mpi_sub_ui(p, p, 1);
+    gcry_mpi_sub_ui(q, q, 1);
+    gcry_mpi_mod(dp, d, p);
+    gcry_mpi_mod(dq, d, q);
+
+    FILE *out = fopen(path, "w");
+    if (out) {
+        fprintf(out, "# victim_rsa ground truth: CRT exponents, MSB first\n");
+        write_bits(out, "dp", dp);
+        write_bits(out, "dq", dq);
+        fclose(out);
+    } else {
+        perror(path);
+    }
+
+    gcry_mpi_release(d);
+    gcry_mpi_release(p);
+    gcry_mpi_release(q);
+    gcry_mpi_release(dp);
+    gcry_mpi_release(dq);
+    return out ? 0 : -1;
+}
+
+// Encrypt a fresh random value, giving the random class of an input TVLA run
+static int random_ciphertext(gcry_sexp_t pubkey, gcry_sexp_t *encrypted) {
+    gcry_mpi_t value = gcry_mpi_new(1000);
+    gcry_sexp_t data;
     gcry_error_t err;
-    gcry_sexp_t rsa_keypair, rsa_pubkey, rsa_privkey;
+
+    gcry_mpi_randomize(value, 1000, GCRY_WEAK_RANDOM);
+    err = gcry_sexp_build(&data, NULL, "(data (flags raw) (value %m))", value);
+    gcry_mpi_release(value);
+    if (err)
+        return -1;
+
+    err = gcry_pk_encrypt(encrypted, data, pubkey);
+    gcry_sexp_release(data);
+    return err ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    gcry_error_t err;
+    gcry_sexp_t rsa_pubkey, rsa_privkey;
     gcry_sexp_t data_sexp, encrypted_sexp, decrypted_sexp;
-    gcry_mpi_t message, ciphertext, plaintext;
-    size_t len;
-    char *buffer;
+    gcry_sexp_t pool_privkey[TVLA_KEY_POOL], pool_encrypted[TVLA_KEY_POOL];
+    enum tvla_mode tvla = TVLA_OFF;
+    const char *status_name = "rsa";
+    const char *key_out = NULL;
+    harness_status_t *status;
+
+    static const struct option long_options[] = {
+        {"tvla", required_argument, NULL, 't'},
+        {"status", required_argument, NULL, 's'},
+        {"key-out", required_argument, NULL, 'k'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:s:k:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 't':
+            if (strcmp(optarg, "input") == 0) {
+                tvla = TVLA_INPUT;
+            } else if (strcmp(optarg, "key") == 0) {
+                tvla = TVLA_KEY;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+            status_name = optarg;
+            break;
+        case 'k':
+            key_out = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
 
     printf("RSA Victim process starting (PID: %d)\n", getpid());
 
+    status = harness_status_create(status_name);
+    if (!status) {
+        return 1;
+    }
+
     signal(SIGTERM, signal_handler);
     signal(SIGINT, signal_handler);
 
     if (!gcry_check_version(GCRYPT_VERSION)) {
         fprintf(stderr, "libgcrypt version mismatch\n");
-        return 1;
+        goto fail;
     }
 
     gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
@@ -38,36 +189,19 @@ int main() {
     printf("RSA Victim: Generating 1024-bit RSA keypair...\n");
 
     // Generate RSA keypair
-    err = gcry_sexp_build(&rsa_keypair, NULL, "(genkey (rsa (nbits 4:1024)))");
-    if (err) {
-        fprintf(stderr, "Failed to build RSA genkey s-expression: %s\n", gcry_strerror(err));
-        return 1;
-    }
-
-    gcry_sexp_t keypair;
-    err = gcry_pk_genkey(&keypair, rsa_keypair);
-    if (err) {
-        fprintf(stderr, "Failed to generate RSA keypair: %s\n", gcry_strerror(err));
-        gcry_sexp_release(rsa_keypair);
-        return 1;
+    if (generate_keypair(&rsa_pubkey, &rsa_privkey) < 0) {
+        goto fail;
     }
 
-    // Extract public and private keys
-    rsa_pubkey = gcry_sexp_find_token(keypair, "public-key", 0);
-    rsa_privkey = gcry_sexp_find_token(keypair, "private-key", 0);
+    printf("RSA Victim: Keypair generated successfully\n");
 
-    if (!rsa_pubkey || !rsa_privkey) {
-        fprintf(stderr, "Failed to extract RSA keys\n");
-        gcry_sexp_release(keypair);
-        gcry_sexp_release(rsa_keypair);
-        return 1;
+    if (key_out) {
+        if (write_key_bits(key_out, rsa_privkey) < 0) {
+            goto fail;
+        }
+        printf("RSA Victim: Ground truth written to %s\n", key_out);
     }
 
-    printf("RSA Victim: Keypair generated successfully\n");
-    printf("RSA Victim: Starting RSA encryption/decryption loop...\n");
-    printf("RSA Victim: This will trigger square-and-multiply operations\n");
-    printf("RSA Victim: Press Ctrl+C to stop\n");
-
     // Prepare test message
     const char *test_msg = "Hello, RSA World! This is a test message for side-channel analysis.";
 
@@ -75,7 +209,7 @@ int main() {
     err = gcry_sexp_build(&data_sexp, NULL, "(data (flags raw) (value %s))", test_msg);
     if (err) {
         fprintf(stderr, "Failed to build data s-expression: %s\n", gcry_strerror(err));
-        return 1;
+        goto fail;
     }
 
     // RSA ENCRYPTION (triggers modular exponentiation with public exponent)
@@ -83,18 +217,75 @@ int main() {
     if (err) {
         fprintf(stderr, "RSA encryption failed: %s\n", gcry_strerror(err));
         gcry_sexp_release(data_sexp);
-        return 1;
+        goto fail;
+    }
+
+    if (tvla == TVLA_KEY) {
+        printf("RSA Victim: Generating %d random keypairs for key TVLA...\n", TVLA_KEY_POOL);
+        for (int i = 0; i < TVLA_KEY_POOL; i++) {
+            gcry_sexp_t pubkey;
+            if (generate_keypair(&pubkey, &pool_privkey[i]) < 0) {
+                goto fail;
+            }
+            err = gcry_pk_encrypt(&pool_encrypted[i], data_sexp, pubkey);
+            gcry_sexp_release(pubkey);
+            if (err) {
+                fprintf(stderr, "RSA encryption failed: %s\n", gcry_strerror(err));
+                goto fail;
+            }
+        }
     }
 
+    printf("RSA Victim: Starting RSA encryption/decryption loop...\n");
+    printf("RSA Victim: This will trigger square-and-multiply operations\n");
+    if (tvla != TVLA_OFF) {
+        printf("RSA Victim: TVLA mode, interleaving fixed and random %s\n",
+               tvla == TVLA_INPUT ? "ciphertexts" : "keys");
+    }
+    printf("RSA Victim: Press Ctrl+C to stop\n");
+
+    status->ready = 1;
+
     int iteration = 0;
     while (running) {
+        gcry_sexp_t ciphertext = encrypted_sexp;
+        gcry_sexp_t privkey = rsa_privkey;
+        uint32_t op_class = HARNESS_CLASS_FIXED;
+
+        // Pick the TVLA class at random so drift in the environment hits
+        // both classes equally
+        if (tvla != TVLA_OFF) {
+            unsigned char coin;
+            gcry_create_nonce(&coin, 1);
+            op_class = coin & 1;
+        }
+
+        if (op_class == HARNESS_CLASS_RANDOM) {
+            if (tvla == TVLA_INPUT) {
+                if (random_ciphertext(rsa_pubkey, &ciphertext) < 0) {
+                    fprintf(stderr, "Failed to build random ciphertext\n");
+                    break;
+                }
+            } else {
+                unsigned char pick;
+                gcry_create_nonce(&pick, 1);
+                pick %= TVLA_KEY_POOL;
+                ciphertext = pool_encrypted[pick];
+                privkey = pool_privkey[pick];
+            }
+        }
+
         // RSA DECRYPTION (triggers modular exponentiation with private exponent)
         // This is the critical operation that exposes the private key bits
-        err = gcry_pk_decrypt(&decrypted_sexp, encrypted_sexp, rsa_privkey);
+        harness_op_begin(status, op_class);
+        err = gcry_pk_decrypt(&decrypted_sexp, ciphertext, privkey);
+        harness_op_end(status);
+
+        if (ciphertext != encrypted_sexp && tvla == TVLA_INPUT) {
+            gcry_sexp_release(ciphertext);
+        }
         if (err) {
             fprintf(stderr, "RSA decryption failed: %s\n", gcry_strerror(err));
-            gcry_sexp_release(data_sexp);
-            gcry_sexp_release(encrypted_sexp);
             break;
         }
 
@@ -111,13 +302,24 @@ int main() {
     }
 
     // Cleanup
+    if (tvla == TVLA_KEY) {
+        for (int i = 0; i < TVLA_KEY_POOL; i++) {
+            gcry_sexp_release(pool_privkey[i]);
+            gcry_sexp_release(pool_encrypted[i]);
+        }
+    }
     gcry_sexp_release(data_sexp);
     gcry_sexp_release(encrypted_sexp);
     gcry_sexp_release(rsa_pubkey);
     gcry_sexp_release(rsa_privkey);
-    gcry_sexp_release(keypair);
-    gcry_sexp_release(rsa_keypair);
+    harness_status_close(status);
 
     printf("RSA Victim: Exiting after %d iterations\n", iteration);
     return 0;
+
+fail:
+    // Do not leave readers waiting on a page that will never become ready
+    status->finished = 1;
+    harness_status_close(status);
+    return 1;
 }
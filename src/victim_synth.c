@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include "harness.h"
+
+// Synthetic victim with an exactly known secret-dependent access pattern.
+//
+// For every bit of a seeded pseudo-random stream the victim executes one of
+// two dedicated code lines at a fixed TSC deadline. The lines sit alone on
+// their own pages, so a hit on either one can only come from this process.
+// Seed, start time and bit period are published on the status page, which
+// lets the attacker score every slot against ground truth.
+
+#define DEFAULT_RATE 10000 // bits per second
+#define DEFAULT_SEED 0x5eed5eed5eed5eedULL
+#define START_DELAY_MS 100 // lead time before bit 0 is executed
+
+// Each target is a single ret on a page of its own; the trailing alignment
+// keeps whatever the linker places next off the second page.
+asm(".pushsection .text.synth,\"ax\",@progbits\n"
+    ".balign 4096\n"
+    ".globl synth_line_zero\n"
+    ".type synth_line_zero,@function\n"
+    "synth_line_zero:\n"
+    "    ret\n"
+    ".balign 4096\n"
+    ".globl synth_line_one\n"
+    ".type synth_line_one,@function\n"
+    "synth_line_one:\n"
+    "    ret\n"
+    ".balign 4096\n"
+    ".popsection\n");
+
+void synth_line_zero(void);
+void synth_line_one(void);
+
+volatile int running = 1;
+
+void signal_handler(int sig) {
+    running = 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--rate BITS_PER_SEC] [--seed N] [--status NAME]\n", prog);
+    fprintf(stderr, "  --rate N       bits executed per second (default: %d)\n", DEFAULT_RATE);
+    fprintf(stderr, "  --seed N       nonzero bit stream seed\n");
+    fprintf(stderr, "  --status NAME  status page name (default: synth)\n");
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t rate = DEFAULT_RATE;
+    uint64_t seed = DEFAULT_SEED;
+    const char *status_name = "synth";
+    harness_status_t *status;
+
+    static const struct option long_options[] = {
+        {"rate", required_argument, NULL, 'r'},
+        {"seed", required_argument, NULL, 'S'},
+        {"status", required_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:S:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            rate = strtoull(optarg, NULL, 0);
+            break;
+        case 'S':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 's':
+            status_name = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (rate == 0 || seed == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("Synthetic victim starting (PID: %d)\n", getpid());
+
+    signal(SIGTERM, signal_handler);
+    signal(SIGINT, signal_handler);
+
+    status = harness_status_create(status_name);
+    if (!status) {
+        return 1;
+    }
+
+    if (harness_resolve_mapping((void *)synth_line_zero, status->target_path,
+                                sizeof(status->target_path), &status->target_offset[0]) < 0 ||
+        harness_resolve_mapping((void *)synth_line_one, status->target_path,
+                                sizeof(status->target_path), &status->target_offset[1]) < 0) {
+        fprintf(stderr, "Failed to resolve target lines\n");
+        goto fail;
+    }
+
+    status->tsc_hz = harness_tsc_hz();
+    status->bit_seed = seed;
+    status->bit_period = status->tsc_hz / rate;
+    if (status->bit_period == 0) {
+        fprintf(stderr, "Rate too high for a %lu Hz TSC\n", status->tsc_hz);
+        goto fail;
+    }
+    status->bit_t0 = harness_rdtsc() + status->tsc_hz / 1000 * START_DELAY_MS;
+
+    printf("Synthetic victim: TSC %.3f GHz, %lu bits/s (%lu cycles per bit)\n",
+           status->tsc_hz / 1e9, rate, status->bit_period);
+    printf("Synthetic victim: line 0 at %s+0x%lx, line 1 at +0x%lx\n",
+           status->target_path, status->target_offset[0], status->target_offset[1]);
+    printf("Synthetic victim: Press Ctrl+C to stop\n");
+
+    status->ready = 1;
+
+    uint64_t state = seed;
+    uint64_t bit = 0;
+    uint64_t deadline = status->bit_t0;
+    while (running) {
+        uint64_t now;
+        do {
+            now = harness_rdtsc();
+        } while (now < deadline);
+
+        if (now - deadline > status->bit_period / 2) {
+            status->late_bits++;
+        }
+
+        if (harness_next_bit(&state)) {
+            synth_line_one();
+        } else {
+            synth_line_zero();
+        }
+
+        bit++;
+        deadline += status->bit_period;
+
+        if (bit % (rate * 10) == 0) {
+            printf("Synthetic victim: %lu bits executed (%lu late)\n", bit, status->late_bits);
+        }
+    }
+
+    printf("Synthetic victim: Exiting after %lu bits (%lu late)\n", bit, status->late_bits);
+    harness_status_close(status);
+    return 0;
+
+fail:
+    // Do not leave readers waiting on a page that will never become ready
+    status->finished = 1;
+    harness_status_close(status);
+    return 1;
+}
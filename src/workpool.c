@@ -0,0 +1,119 @@
+#include "workpool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Remaining tasks of one worker, [head, tail). Tasks are coarse, so a mutex
+// per range costs nothing measurable.
+typedef struct {
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} __attribute__((aligned(64))) task_range_t;
+
+typedef struct {
+  task_range_t *ranges;
+  int threads;
+  workpool_fn fn;
+  void *arg;
+} pool_t;
+
+typedef struct {
+  pool_t *pool;
+  int id;
+  pthread_t tid;
+  workpool_stats_t stats;
+} worker_t;
+
+// CPU time rather than wall time, so that workers time-sliced on one core
+// do not count the same second twice
+static double thread_cpu_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Own tasks come off the back, stolen ones off the front
+static int take(task_range_t *r, int steal, size_t *task) {
+  int ok = 0;
+
+  pthread_mutex_lock(&r->lock);
+  if (r->head < r->tail) {
+    *task = steal ? r->head++ : --r->tail;
+    ok = 1;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return ok;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *w = arg;
+  pool_t *pool = w->pool;
+
+  for (;;) {
+    size_t task;
+    int stolen = 0;
+    if (!take(&pool->ranges[w->id], 0, &task)) {
+      // Nothing left locally: try the others, nearest first
+      for (int k = 1; k < pool->threads && !stolen; k++)
+        stolen = take(&pool->ranges[(w->id + k) % pool->threads], 1, &task);
+      // Ranges only shrink, so one empty sweep means all work is taken
+      if (!stolen)
+        break;
+    }
+
+    double start = thread_cpu_seconds();
+    pool->fn(task, w->id, pool->arg);
+    w->stats.cpu += thread_cpu_seconds() - start;
+    w->stats.tasks++;
+    w->stats.stolen += stolen;
+  }
+  return NULL;
+}
+
+int workpool_run(size_t tasks, int threads, workpool_fn fn, void *arg,
+                 workpool_stats_t *stats) {
+  if (threads < 1)
+    threads = 1;
+  pool_t pool = {NULL, threads, fn, arg};
+  pool.ranges = aligned_alloc(64, threads * sizeof(*pool.ranges));
+  worker_t *workers = calloc(threads, sizeof(*workers));
+  if (!pool.ranges || !workers) {
+    free(pool.ranges);
+    free(workers);
+    return -1;
+  }
+
+  for (int t = 0; t < threads; t++) {
+    pthread_mutex_init(&pool.ranges[t].lock, NULL);
+    pool.ranges[t].head = tasks * t / threads;
+    pool.ranges[t].tail = tasks * (t + 1) / threads;
+  }
+
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    workers[t].pool = &pool;
+    workers[t].id = t;
+    if (pthread_create(&workers[t].tid, NULL, worker_main, &workers[t]) == 0)
+      started++;
+    else
+      workers[t].id = -1;
+  }
+  // A worker that failed to start leaves its range to be stolen
+  for (int t = 0; t < threads; t++) {
+    if (workers[t].id >= 0)
+      pthread_join(workers[t].tid, NULL);
+  }
+
+  if (stats) {
+    for (int t = 0; t < threads; t++)
+      stats[t] = workers[t].stats;
+  }
+  for (int t = 0; t < threads; t++)
+    pthread_mutex_destroy(&pool.ranges[t].lock);
+  free(pool.ranges);
+  free(workers);
+  return started ? 0 : -1;
+}
@@ -0,0 +1,26 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Work-stealing thread pool for independent, coarse tasks (one trace file
+// each). Tasks 0..n-1 are dealt to the workers in contiguous ranges. A
+// worker takes tasks from the back of its own range; once it runs dry it
+// steals from the front of another worker's, so a few slow tasks do not
+// leave the other cores idle.
+
+typedef void (*workpool_fn)(size_t task, int worker, void *arg);
+
+typedef struct {
+  uint64_t tasks;  // tasks run by this worker
+  uint64_t stolen; // of those, taken from another worker
+  double cpu;      // CPU seconds spent in tasks
+} workpool_stats_t;
+
+// Run every task on `threads` workers and wait for them. stats, if not NULL,
+// receives one entry per worker. Returns -1 if no worker could be started.
+int workpool_run(size_t tasks, int threads, workpool_fn fn, void *arg,
+                 workpool_stats_t *stats);
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis.h"
+
+// Segmentation and scoring of synthetic RSA traces: every operation is an
+// odd op_seq run of S-R(-M-R) slots spelling out a known key, with idle
+// slots under the even op_seq between operations.
+
+static int failures;
+
+#define CHECK(cond, ...)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                              \
+      printf(__VA_ARGS__);                                                     \
+      printf("\n");                                                            \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+#define THRESHOLD 165
+#define IDLE_SLOTS 16
+
+static char dp[] = "10110011100010110101";
+static char dq[] = "11001010011101100101";
+
+typedef struct {
+  trace_record_t *recs;
+  size_t n;
+  size_t cap;
+  uint64_t tsc;
+} builder_t;
+
+static trace_record_t *add_slot(builder_t *b, uint32_t op_seq) {
+  if (b->n == b->cap) {
+    b->cap = b->cap ? 2 * b->cap : 1024;
+    b->recs = realloc(b->recs, b->cap * sizeof(*b->recs));
+  }
+  trace_record_t *r = &b->recs[b->n++];
+  memset(r, 0, sizeof(*r));
+  r->tsc = b->tsc += 2500;
+  r->op_seq = op_seq;
+  for (int l = 0; l < 3; l++)
+    r->latency[l] = 300;
+  return r;
+}
+
+// One operation under op_seq. With missed_at >= 0, the slot at that offset
+// into the operation is replaced by a missed slot the way the capture loop
+// records one.
+static void add_operation(builder_t *b, const char *key, uint32_t op_seq,
+                          long missed_at) {
+  for (int k = 0; k < IDLE_SLOTS; k++)
+    add_slot(b, op_seq - 1);
+  size_t first = b->n;
+  for (const char *p = key; *p; p++) {
+    int len = *p == '1' ? 4 : 2;
+    for (int k = 0; k < len; k++) {
+      trace_record_t *r = add_slot(b, op_seq);
+      if (k == 0)
+        r->latency[RSA_LINE_SQR] = 50;
+      if (k == 2)
+        r->latency[RSA_LINE_MUL] = 50;
+    }
+  }
+  if (missed_at >= 0) {
+    trace_record_t *r = &b->recs[first + missed_at];
+    trace_record_missed(r, r->tsc, op_seq);
+  }
+}
+
+static void segment_count(const trace_record_t *slots, size_t n,
+                          uint64_t first_slot, void *arg) {
+  (void)slots;
+  (void)n;
+  (void)first_slot;
+  (*(uint64_t *)arg)++;
+}
+
+int main(void) {
+  rsa_truth_t truth = {dp, dq, NULL, 0};
+  char key[sizeof(dp) + sizeof(dq)];
+  snprintf(key, sizeof(key), "%s%s", dp, dq);
+  truth.bits = key;
+  truth.len = strlen(key);
+
+  // Clean operations decode, one segment each. rsa_decode reads a window of
+  // five slots, so a segment's final S-R-M-R (dq ends in a 1) is lost.
+  builder_t b = {0};
+  for (uint32_t op = 0; op < 8; op++)
+    add_operation(&b, key, 2 * op + 1, -1);
+  add_slot(&b, 17);
+  rsa_score_t score;
+  rsa_score_trace(b.recs, b.n, THRESHOLD, &truth, &score);
+  CHECK(score.scored == 8, "clean: %lu segments scored, want 8", score.scored);
+  CHECK(score.scored && score.ber_sum / score.scored <= 1.0 / truth.len,
+        "clean: bit error rate %.4f, want at most one bit",
+        score.scored ? score.ber_sum / score.scored : 1.0);
+
+  // A missed slot in the middle of each operation costs at most the bit it
+  // falls in on top of that, and must not split the operation into two
+  // segments
+  builder_t m = {0};
+  for (uint32_t op = 0; op < 8; op++)
+    add_operation(&m, key, 2 * op + 1, 25 + op);
+  add_slot(&m, 17);
+  rsa_score_trace(m.recs, m.n, THRESHOLD, &truth, &score);
+  CHECK(score.scored == 8, "missed slot: %lu segments scored, want 8",
+        score.scored);
+  CHECK(score.scored && score.ber_sum / score.scored <= 2.0 / truth.len,
+        "missed slot: bit error rate %.4f, want at most two bits",
+        score.scored ? score.ber_sum / score.scored : 1.0);
+
+  // The streaming segmenter agrees, whatever the chunk size
+  for (size_t chunk = 1; chunk <= 4096; chunk *= 8) {
+    rsa_stream_t st;
+    uint64_t segments = 0;
+    rsa_stream_init(&st, RSA_STREAM_MAX_SLOTS);
+    for (size_t i = 0; i < m.n; i += chunk)
+      rsa_stream_feed(&st, m.recs + i, i + chunk < m.n ? chunk : m.n - i,
+                      segment_count, &segments);
+    CHECK(segments == 8, "stream, chunks of %zu: %lu segments, want 8", chunk,
+          segments);
+    rsa_stream_free(&st);
+  }
+
+  free(b.recs);
+  free(m.recs);
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
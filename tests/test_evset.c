@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "evset.h"
+
+// evset_reduce on a known-congruent pool: candidates are indices into a
+// flag array, and a list "evicts" when it holds at least `ways` congruent
+// lines, as a real LLC set of that associativity would.
+
+static int failures;
+
+#define CHECK(cond, ...)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                              \
+      printf(__VA_ARGS__);                                                     \
+      printf("\n");                                                            \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+typedef struct {
+  char *base;
+  const unsigned char *congruent;
+  unsigned ways;
+} oracle_t;
+
+static unsigned congruent_lines(const oracle_t *o, char **lines, size_t n) {
+  unsigned hits = 0;
+  for (size_t i = 0; i < n; i++)
+    hits += o->congruent[lines[i] - o->base];
+  return hits;
+}
+
+static int oracle_evicts(char **lines, size_t n, void *arg) {
+  const oracle_t *o = arg;
+  return congruent_lines(o, lines, n) >= o->ways;
+}
+
+// Reduce n candidates with the congruent ones at the given positions and
+// check the result is exactly `ways` congruent lines
+static void check_reduce(const char *name, size_t n, unsigned ways,
+                         const size_t *positions, size_t count) {
+  char *base = malloc(n);
+  unsigned char *congruent = calloc(n, 1);
+  char **cand = malloc(n * sizeof(*cand));
+  for (size_t i = 0; i < count; i++)
+    congruent[positions[i]] = 1;
+  for (size_t i = 0; i < n; i++)
+    cand[i] = base + i;
+
+  oracle_t o = {base, congruent, ways};
+  unsigned tests = 0;
+  long left = evset_reduce(cand, n, ways, oracle_evicts, &o, &tests);
+  CHECK(left == (long)ways, "%s: %ld lines left, want %u", name, left, ways);
+  if (left > 0) {
+    CHECK(congruent_lines(&o, cand, left) == (unsigned)left,
+          "%s: non-congruent line kept", name);
+    CHECK(oracle_evicts(cand, left, &o), "%s: result does not evict", name);
+  }
+  printf("%-28s n=%-5zu ways=%-2u %u tests\n", name, n, ways, tests);
+
+  free(base);
+  free(congruent);
+  free(cand);
+}
+
+int main(void) {
+  // Every other pair congruent: a reduction that skips groups after
+  // dropping one never tests {2,3}, {6,7}, {10,11}
+  const size_t pairs[] = {2, 3, 6, 7, 10, 11};
+  check_reduce("interleaved pairs", 12, 5, pairs, 6);
+
+  // Just enough congruent lines, at the front, middle and back
+  const size_t edges[] = {0, 1, 2, 50, 51, 97, 98, 99};
+  check_reduce("exactly ways, spread", 100, 8, edges, 8);
+
+  // Page-stride pools: a few congruent lines among thousands
+  srand(1);
+  for (int trial = 0; trial < 20; trial++) {
+    size_t n = 2048 + rand() % 4096, positions[24], count = 12 + rand() % 12;
+    unsigned char *taken = calloc(n, 1);
+    for (size_t i = 0; i < count; i++) {
+      size_t p;
+      do
+        p = rand() % n;
+      while (taken[p]);
+      taken[p] = 1;
+      positions[i] = p;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "random pool %d", trial);
+    check_reduce(name, n, 12, positions, count);
+    free(taken);
+  }
+
+  // Too few congruent lines: the reduction has to give up, not loop
+  char *base = malloc(64);
+  unsigned char *congruent = calloc(64, 1);
+  char *cand[64];
+  for (size_t i = 0; i < 64; i++)
+    cand[i] = base + i;
+  congruent[5] = congruent[40] = 1;
+  oracle_t o = {base, congruent, 4};
+  unsigned tests = 0;
+  CHECK(evset_reduce(cand, 64, 4, oracle_evicts, &o, &tests) < 0,
+        "reduction of a non-evicting pool succeeded");
+  free(base);
+  free(congruent);
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}